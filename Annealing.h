@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+// Temperature schedules for Metropolis acceptance in swap.hlsl. A swap that raises the loss by delta is accepted
+// with probability exp(-delta / temperature), so a temperature of 0 is the greedy optimization.
+struct AnnealingSchedule
+{
+    enum class Type
+    {
+        None,       // Greedy: only swaps that lower the loss are accepted
+        Geometric,  // Temperature decays geometrically from m_startTemperature to m_param at the last step
+        Adaptive,   // Temperature is adjusted so the uphill acceptance rate follows a target that falls linearly from m_param to 0
+    };
+
+    Type m_type = Type::None;
+    float m_startTemperature = 0.0f;
+    float m_param = 0.0f;
+
+    // Current temperature. Only changed by the adaptive schedule between steps.
+    float m_temperature = 0.0f;
+
+    void Start()
+    {
+        m_temperature = (m_type == Type::None) ? 0.0f : m_startTemperature;
+    }
+
+    // progress goes from 0 at the first step to 1 at the last
+    float GetTemperature(float progress) const
+    {
+        switch (m_type)
+        {
+            case Type::Geometric: return m_startTemperature * std::pow(m_param / m_startTemperature, progress);
+            case Type::Adaptive: return m_temperature;
+            default: return 0.0f;
+        }
+    }
+
+    // Called with the swap statistics of the step that was read back.
+    // uphillProposals is the number of pairs whose swap would raise the loss, uphillSwaps how many of them were accepted.
+    void Update(float progress, unsigned int uphillProposals, unsigned int uphillSwaps, unsigned int swapSuppression)
+    {
+        if (m_type != Type::Adaptive || uphillProposals == 0)
+            return;
+
+        // Swap suppression gates every swap, so take it out of the acceptance rate
+        float acceptanceRate = float(uphillSwaps) * float(swapSuppression) / float(uphillProposals);
+        float targetRate = m_param * (1.0f - progress);
+
+        static const float c_adjust = 1.25f;
+        m_temperature = (acceptanceRate < targetRate) ? m_temperature * c_adjust : m_temperature / c_adjust;
+    }
+};
+
+// Parallel tempering: several replicas run at once, each at a fixed temperature from a geometric ladder between
+// m_minTemperature and m_maxTemperature. Every m_exchangeInterval steps neighbouring temperatures are offered an exchange.
+struct ReplicaLadder
+{
+    int m_count = 0;
+    float m_minTemperature = 0.0f;
+    float m_maxTemperature = 0.0f;
+    size_t m_exchangeInterval = 0; // 0 means exchange whenever the status is reported
+
+    // Coldest first. Empty when not using replicas.
+    std::vector<float> GetTemperatures() const
+    {
+        std::vector<float> ret;
+        for (int i = 0; i < m_count; ++i)
+        {
+            float t = (m_count > 1) ? float(i) / float(m_count - 1) : 0.0f;
+            ret.push_back(m_minTemperature * std::pow(m_maxTemperature / m_minTemperature, t));
+        }
+        return ret;
+    }
+};
@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#define NOMINMAX
+#define _CRT_SECURE_NO_WARNINGS
+#include "CSVWriter.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace CSVWriter
+{
+    // Enough for the longest shortest-round-trip float, "-1.1754944e-38", plus the quotes and comma
+    static const size_t c_maxValueChars = 24;
+
+    // Rows are grouped into chunks of about this many bytes of text
+    static const size_t c_chunkBytes = 1024 * 1024;
+
+    // Number of recently formatted values FormatRows keeps the text of
+    static const int c_cacheBits = 4;
+    static const int c_cacheSize = 1 << c_cacheBits;
+
+    // Formats rows [rowStart, rowEnd) into text, keeping the first components channels of each pixel, and returns the length
+    static size_t FormatRows(std::vector<char>& text, const float* pixels, int rowStart, int rowEnd, int width, int srcComponents, int components)
+    {
+        // Only grown, so the buffer isn't cleared again for every chunk. The extra c_maxValueChars is room for the fixed size
+        // copy of the last value.
+        const size_t maxLength = size_t(rowEnd - rowStart) * (size_t(width) * components * c_maxValueChars + 1) + c_maxValueChars;
+        if (text.size() < maxLength)
+            text.resize(maxLength);
+        char* out = text.data();
+
+        // Scalar noise repeats its value in RGB and most noise has a constant alpha, so the text of recent values is kept in
+        // a small cache, indexed by a hash of their bits, and copied when a value comes up again
+        struct CachedValue
+        {
+            uint32_t bits = 0;
+            size_t length = 1;
+            char text[c_maxValueChars] = "0";
+        };
+        CachedValue cache[c_cacheSize];
+
+        const float* pixel = &pixels[size_t(rowStart) * width * srcComponents];
+        for (int iy = rowStart; iy < rowEnd; ++iy)
+        {
+            for (int ix = 0; ix < width; ++ix)
+            {
+                for (int i = 0; i < components; ++i)
+                {
+                    uint32_t bits;
+                    memcpy(&bits, &pixel[i], sizeof(bits));
+                    CachedValue& cached = cache[(bits * 0x9E3779B1u) >> (32 - c_cacheBits)];
+
+                    *out++ = '"';
+                    if (cached.bits != bits)
+                    {
+                        cached.bits = bits;
+                        cached.length = std::to_chars(cached.text, cached.text + sizeof(cached.text), pixel[i]).ptr - cached.text;
+                    }
+                    memcpy(out, cached.text, sizeof(cached.text));
+                    out += cached.length;
+                    out[0] = '"';
+                    out[1] = ',';
+                    out += 2;
+                }
+                pixel += srcComponents;
+            }
+
+            // The comma after the last value becomes the end of the line
+            out[-1] = '\n';
+        }
+
+        return out - text.data();
+    }
+
+    bool Save(const char* fileName, const float* pixels, int width, int height, int srcComponents, int components, ThreadPool* threadPool)
+    {
+        FILE* file = nullptr;
+        fopen_s(&file, fileName, "wb");
+        if (!file)
+            return false;
+
+        const int chunkRows = std::max((int)(c_chunkBytes / (size_t(width) * components * c_maxValueChars + 1)), 1);
+        const int chunkCount = (height + chunkRows - 1) / chunkRows;
+
+        // One batch is a chunk per thread, formatted together and then written in order
+        const int threadCount = threadPool ? threadPool->GetThreadCount() + 1 : 1;
+        std::vector<std::vector<char>> texts(threadCount);
+        std::vector<size_t> textLengths(threadCount);
+
+        bool success = true;
+        for (int batchStart = 0; batchStart < chunkCount && success; batchStart += threadCount)
+        {
+            const int batchCount = std::min(threadCount, chunkCount - batchStart);
+            auto formatChunk = [&](int index, int)
+            {
+                int rowStart = (batchStart + index) * chunkRows;
+                int rowEnd = std::min(rowStart + chunkRows, height);
+                textLengths[index] = FormatRows(texts[index], pixels, rowStart, rowEnd, width, srcComponents, components);
+            };
+
+            if (threadPool && batchCount > 1)
+                threadPool->ParallelFor(batchCount, formatChunk);
+            else
+                formatChunk(0, 0);
+
+            for (int index = 0; index < batchCount && success; ++index)
+                success = fwrite(texts[index].data(), 1, textLengths[index], file) == textLengths[index];
+        }
+
+        fclose(file);
+        return success;
+    }
+
+    bool SaveF32(const char* fileName, const float* pixels, size_t pixelCount, int srcComponents, int components)
+    {
+        FILE* file = nullptr;
+        fopen_s(&file, fileName, "wb");
+        if (!file)
+            return false;
+
+        bool success = true;
+        if (components == srcComponents)
+        {
+            size_t count = pixelCount * components;
+            success = fwrite(pixels, sizeof(float), count, file) == count;
+        }
+        else
+        {
+            // Gather the channels that are kept a block of pixels at a time
+            static const size_t c_blockPixels = 64 * 1024;
+            std::vector<float> block(c_blockPixels * components);
+            for (size_t blockStart = 0; blockStart < pixelCount && success; blockStart += c_blockPixels)
+            {
+                size_t blockPixels = std::min(c_blockPixels, pixelCount - blockStart);
+                for (size_t pixel = 0; pixel < blockPixels; ++pixel)
+                {
+                    for (int i = 0; i < components; ++i)
+                        block[pixel * components + i] = pixels[(blockStart + pixel) * srcComponents + i];
+                }
+                success = fwrite(block.data(), sizeof(float), blockPixels * components, file) == blockPixels * components;
+            }
+        }
+
+        fclose(file);
+        return success;
+    }
+}
@@ -0,0 +1,21 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+
+class ThreadPool;
+
+// Writes float pixels as CSV, one image row per line with each value quoted, keeping the first components channels of each
+// pixel. Values are the text std::to_chars gives, the shortest that reads back to the same float. Rows are formatted in chunks, in parallel
+// on the thread pool if one is given, and the chunks are written to the file in order a batch at a time, so memory use is bounded.
+namespace CSVWriter
+{
+    bool Save(const char* fileName, const float* pixels, int width, int height, int srcComponents, int components, ThreadPool* threadPool);
+
+    // The raw little endian floats, with no header. The .f32 sidecar that -f32 writes next to a CSV.
+    bool SaveF32(const char* fileName, const float* pixels, size_t pixelCount, int srcComponents, int components);
+}
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#define NOMINMAX
+#include "Energy.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+// Matches K2() in loss.hlsl
+static float K2(fastnoise::SampleSpace sampleSpace, const float* x, const float* y)
+{
+    switch (sampleSpace)
+    {
+        case fastnoise::SampleSpace::Real:
+        {
+            return -std::abs(x[0] - y[0]);
+        }
+        case fastnoise::SampleSpace::Circle:
+        {
+            float d = x[0] - y[0];
+            return -std::min(std::abs(d), std::min(std::abs(d + 1.0f), std::abs(d - 1.0f)));
+        }
+        case fastnoise::SampleSpace::Vector2:
+        case fastnoise::SampleSpace::Vector3:
+        case fastnoise::SampleSpace::Vector4:
+        {
+            int components = (sampleSpace == fastnoise::SampleSpace::Vector2) ? 2 : ((sampleSpace == fastnoise::SampleSpace::Vector3) ? 3 : 4);
+            float lengthSquared = 0.0f;
+            for (int i = 0; i < components; ++i)
+                lengthSquared += (x[i] - y[i]) * (x[i] - y[i]);
+            return -std::sqrt(lengthSquared);
+        }
+        case fastnoise::SampleSpace::Sphere:
+        {
+            float dot = 0.0f;
+            for (int i = 0; i < 3; ++i)
+                dot += (2.0f * x[i] - 1.0f) * (2.0f * y[i] - 1.0f);
+            return -std::acos(std::max(std::min(dot, 1.0f), 0.0f));
+        }
+    }
+    return 0.0f;
+}
+
+// Matches combineFilter() in loss.hlsl
+static float CombineFilter(const fastnoise::Context::ContextInput& settings, int i, int j, int k, float filterX, float filterY, float filterZ)
+{
+    if (!settings.variable_separate)
+        return filterX * filterY * filterZ;
+
+    float F = 0.0f;
+    if (k == 0)
+        F += filterX * filterY * settings.variable_separateWeight;
+    if (i == 0 && j == 0)
+        F += filterZ * (1.0f - settings.variable_separateWeight);
+    return F;
+}
+
+double CalculateEnergy(const fastnoise::Context::ContextInput& settings, const std::vector<float>& filter, const float* pixels, ThreadPool* threadPool)
+{
+    const int width = (int)settings.variable_TextureSize[0];
+    const int height = (int)settings.variable_TextureSize[1];
+    const int depth = (int)settings.variable_TextureSize[2];
+    const fastnoise::int3& filterMin = settings.variable_filterMin;
+    const fastnoise::int3& filterMax = settings.variable_filterMax;
+    const fastnoise::int3& filterOffset = settings.variable_filterOffset;
+
+    // Each row of each slice is summed on its own, then the rows are summed in order, so the result doesn't depend on the thread count
+    const int rowCount = height * depth;
+    std::vector<double> rowEnergy(rowCount, 0.0);
+
+    auto processRow = [&](int row, int)
+    {
+        const int y = row % height;
+        const int z = row / height;
+
+        double energy = 0.0;
+        for (int x = 0; x < width; ++x)
+        {
+            const float* value = &pixels[(size_t(row) * width + x) * 4];
+
+            for (int i = filterMin[0]; i <= filterMax[0]; ++i)
+            {
+                const float filterX = filter[i + filterOffset[0]];
+                const int neighbourX = ((x + i) % width + width) % width;
+
+                for (int j = filterMin[1]; j <= filterMax[1]; ++j)
+                {
+                    const float filterY = filter[j + filterOffset[1]];
+                    const int neighbourY = ((y + j) % height + height) % height;
+
+                    for (int k = filterMin[2]; k <= filterMax[2]; ++k)
+                    {
+                        const float F = CombineFilter(settings, i, j, k, filterX, filterY, filter[k + filterOffset[2]]);
+                        if (F == 0.0f)
+                            continue;
+
+                        const int neighbourZ = ((z + k) % depth + depth) % depth;
+                        const float* neighbourValue = &pixels[((size_t(neighbourZ) * height + neighbourY) * width + neighbourX) * 4];
+                        energy += F * K2(settings.variable_sampleSpace, value, neighbourValue);
+                    }
+                }
+            }
+        }
+        rowEnergy[row] = energy;
+    };
+
+    if (threadPool)
+    {
+        threadPool->ParallelFor(rowCount, processRow);
+    }
+    else
+    {
+        for (int row = 0; row < rowCount; ++row)
+            processRow(row, 0);
+    }
+
+    double energy = 0.0;
+    for (double e : rowEnergy)
+        energy += e;
+    return energy / (double(width) * double(height) * double(depth));
+}
@@ -0,0 +1,20 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "fastnoise/public/technique.h"
+#include <vector>
+
+class ThreadPool;
+
+// The loss that the optimization minimizes, evaluated on the CPU for a whole texture: for every pixel, the sum over the
+// filter footprint of the combined filter weight times K2 of the pixel and its neighbour, as in loss.hlsl.
+// The result is divided by the pixel count so textures of different sizes can be compared. Lower is better.
+//
+// pixels are the RGBA F32 texture as read back from the GPU: textureSize.x wide and textureSize.y * textureSize.z tall.
+// filter is the filter buffer built in main.cpp, indexed with filterMin / filterMax / filterOffset.
+// The rows are spread over the thread pool, or done on the calling thread without one.
+double CalculateEnergy(const fastnoise::Context::ContextInput& settings, const std::vector<float>& filter, const float* pixels, ThreadPool* threadPool = nullptr);
@@ -0,0 +1,199 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InitFile.h"
+#include <stdio.h>
+#include <string.h>
+
+static float HalfToFloat(uint16_t h)
+{
+    uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+
+    uint32_t bits;
+    if (exponent == 0x1f)
+    {
+        // inf and nan
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else if (mantissa != 0)
+    {
+        // denormal, which is normal as a float
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    else
+    {
+        bits = sign;
+    }
+
+    float ret;
+    memcpy(&ret, &bits, sizeof(ret));
+    return ret;
+}
+
+template <typename T>
+static float ToFloat(T value);
+
+template <>
+float ToFloat<float>(float value)
+{
+    return value;
+}
+
+template <>
+float ToFloat<uint16_t>(uint16_t value)
+{
+    return HalfToFloat(value);
+}
+
+template <typename T, uint32_t CHANNELS>
+static void Expand(float* dest, const unsigned char* pixels, size_t pixelCount)
+{
+    const T* src = (const T*)pixels;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        switch (CHANNELS)
+        {
+            case 1:
+            {
+                float value = ToFloat<T>(src[0]);
+                dest[0] = dest[1] = dest[2] = value;
+                dest[3] = 1.0f;
+                break;
+            }
+            case 2:
+            {
+                dest[0] = ToFloat<T>(src[0]);
+                dest[1] = ToFloat<T>(src[1]);
+                dest[2] = 0.0f;
+                dest[3] = 1.0f;
+                break;
+            }
+            default:
+            {
+                for (uint32_t c = 0; c < 4; ++c)
+                    dest[c] = ToFloat<T>(src[c]);
+                break;
+            }
+        }
+        src += CHANNELS;
+        dest += 4;
+    }
+}
+
+void InitFile::Close()
+{
+    m_file.Close();
+    m_pixels = nullptr;
+    m_pixelCount = 0;
+}
+
+InitFile::Result InitFile::Open(const char* fileName, const unsigned int dims[3], char* error, size_t errorSize)
+{
+    Close();
+    error[0] = 0;
+
+    switch (m_file.Open(fileName, true))
+    {
+        case MappedFile::Result::OK: break;
+        case MappedFile::Result::Empty:
+        {
+            sprintf_s(error, errorSize, "init file \"%s\" is empty.", fileName);
+            return Result::WrongSize;
+        }
+        case MappedFile::Result::NoMap:
+        {
+            sprintf_s(error, errorSize, "Could not map init file \"%s\".", fileName);
+            return Result::NoOpen;
+        }
+        default:
+        {
+            sprintf_s(error, errorSize, "Could not open init file for reading \"%s\".", fileName);
+            return Result::NoOpen;
+        }
+    }
+
+    const unsigned char* view = m_file.GetData();
+    size_t byteCount = m_file.GetSize();
+    size_t pixelCount = size_t(dims[0]) * size_t(dims[1]) * size_t(dims[2]);
+
+    // Only the header is touched here
+    Header header;
+    bool hasHeader = byteCount >= sizeof(header) && !memcmp(view, "FNIT", 4);
+    if (!hasHeader)
+    {
+        // No header means raw float4s
+        m_pixels = view;
+        m_channels = 4;
+        m_type = Type::Float;
+    }
+    else
+    {
+        memcpy(&header, view, sizeof(header));
+        if (header.version != c_version || (header.channels != 1 && header.channels != 2 && header.channels != 4) || (header.type != Type::Float && header.type != Type::Half))
+        {
+            sprintf_s(error, errorSize, "init file has an unsupported header: version %u, %u channels, type %u.", header.version, header.channels, (uint32_t)header.type);
+            Close();
+            return Result::BadHeader;
+        }
+
+        if (header.dims[0] != dims[0] || header.dims[1] != dims[1] || header.dims[2] != dims[2])
+        {
+            sprintf_s(error, errorSize, "init file is %u x %u x %u but the texture is %u x %u x %u.", header.dims[0], header.dims[1], header.dims[2], dims[0], dims[1], dims[2]);
+            Close();
+            return Result::WrongSize;
+        }
+
+        m_pixels = view + sizeof(header);
+        m_channels = header.channels;
+        m_type = header.type;
+        byteCount -= sizeof(header);
+    }
+
+    size_t desiredByteCount = pixelCount * m_channels * (m_type == Type::Half ? sizeof(uint16_t) : sizeof(float));
+    if (byteCount != desiredByteCount)
+    {
+        sprintf_s(error, errorSize, "init file was wrong size: %zu bytes of pixels instead of %zu bytes.", byteCount, desiredByteCount);
+        Close();
+        return Result::WrongSize;
+    }
+
+    m_pixelCount = pixelCount;
+    return Result::OK;
+}
+
+void InitFile::ExpandToFloat4(float* dest) const
+{
+    if (m_type == Type::Half)
+    {
+        switch (m_channels)
+        {
+            case 1: Expand<uint16_t, 1>(dest, m_pixels, m_pixelCount); break;
+            case 2: Expand<uint16_t, 2>(dest, m_pixels, m_pixelCount); break;
+            default: Expand<uint16_t, 4>(dest, m_pixels, m_pixelCount); break;
+        }
+    }
+    else
+    {
+        switch (m_channels)
+        {
+            case 1: Expand<float, 1>(dest, m_pixels, m_pixelCount); break;
+            case 2: Expand<float, 2>(dest, m_pixels, m_pixelCount); break;
+            // Already float4, so a straight copy from the mapping
+            default: memcpy(dest, m_pixels, m_pixelCount * sizeof(float) * 4); break;
+        }
+    }
+}
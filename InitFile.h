@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// The -init file, memory mapped. Only the header and the file size are looked at when opening it, so a wrong
+// sized file is caught without reading the payload. The pixels are read once, when ExpandToFloat4() writes
+// them into the upload heap.
+//
+// The file is either raw float4s, which is the original format, or a 32 byte header followed by the pixels:
+//
+//   char     magic[4]      "FNIT"
+//   uint32_t version       1
+//   uint32_t dims[3]       must match -size
+//   uint32_t channels      1, 2 or 4
+//   uint32_t type          0 = float, 1 = half
+//   uint32_t reserved      0
+//
+// Missing channels are filled in the same way init.hlsl fills them: a single value is broadcast to xyz with
+// w = 1, and two values get z = 0, w = 1.
+class InitFile
+{
+public:
+    enum class Result
+    {
+        OK,
+        NoOpen,
+        BadHeader,
+        WrongSize,
+    };
+
+    enum class Type : uint32_t
+    {
+        Float = 0,
+        Half = 1,
+    };
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t dims[3];
+        uint32_t channels;
+        Type type;
+        uint32_t reserved;
+    };
+
+    static const uint32_t c_version = 1;
+
+    // Maps the file and checks it holds exactly dims[0]*dims[1]*dims[2] pixels. error describes a failure.
+    Result Open(const char* fileName, const unsigned int dims[3], char* error, size_t errorSize);
+
+    size_t GetPixelCount() const { return m_pixelCount; }
+    uint32_t GetChannels() const { return m_channels; }
+    Type GetType() const { return m_type; }
+
+    // Writes GetPixelCount() float4s to dest
+    void ExpandToFloat4(float* dest) const;
+
+private:
+    void Close();
+
+    const unsigned char* m_pixels = nullptr;
+    size_t m_pixelCount = 0;
+    uint32_t m_channels = 4;
+    Type m_type = Type::Float;
+
+    MappedFile m_file;
+};
@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include "MappedFile.h"
+#include <windows.h>
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+void MappedFile::Close()
+{
+    if (m_view)
+        UnmapViewOfFile(m_view);
+    if (m_mapping)
+        CloseHandle((HANDLE)m_mapping);
+    if (m_file)
+        CloseHandle((HANDLE)m_file);
+
+    m_view = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+}
+
+MappedFile::Result MappedFile::Open(const char* fileName, bool sequential)
+{
+    Close();
+
+    DWORD flags = FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS);
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return Result::NoOpen;
+    m_file = file;
+
+    // A zero sized file can't be mapped
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        Close();
+        return Result::Empty;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping)
+        m_view = MapViewOfFile((HANDLE)m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_view)
+    {
+        Close();
+        return Result::NoMap;
+    }
+
+    m_size = (size_t)fileSize.QuadPart;
+    return Result::OK;
+}
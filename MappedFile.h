@@ -0,0 +1,40 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+
+// A whole file mapped read only. Nothing is read when it is opened: pages are faulted in as they are touched.
+class MappedFile
+{
+public:
+    enum class Result
+    {
+        OK,
+        NoOpen,
+        Empty,
+        NoMap,
+    };
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // sequential hints that the file will be read front to back once, as opposed to random access
+    Result Open(const char* fileName, bool sequential);
+    void Close();
+
+    const unsigned char* GetData() const { return (const unsigned char*)m_view; }
+    size_t GetSize() const { return m_size; }
+
+private:
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+    const void* m_view = nullptr;
+    size_t m_size = 0;
+};
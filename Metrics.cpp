@@ -0,0 +1,351 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#define NOMINMAX
+#include "Metrics.h"
+#include "SampleSpace.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+static const int c_maskCount = 8;
+
+// A Heaviside function of the sample space. A pixel is in the mask if dot(direction, value) < threshold, or for circle, if
+// it is within length of threshold going around the circle. Thresholds are the value of a random pixel, so the fraction of
+// pixels in a mask is uniform whatever the distribution is.
+struct Heaviside
+{
+    float direction[4] = {};
+    float threshold = 0.0f;
+    float length = 0.0f;
+};
+
+// Filters along one axis, with wrap around. The data is outerCount blocks of n lines of innerCount floats, and the filter
+// runs across the lines. Each tap is a shifted copy of the block, which is two contiguous runs, either side of the wrap.
+static void FilterAxis(const float* src, float* dst, int outerCount, int n, int innerCount, int filterMin, int filterMax, const float* weights)
+{
+    const size_t blockSize = size_t(n) * innerCount;
+    for (int outer = 0; outer < outerCount; ++outer)
+    {
+        const float* in = src + size_t(outer) * blockSize;
+        float* out = dst + size_t(outer) * blockSize;
+        std::fill(out, out + blockSize, 0.0f);
+
+        for (int tap = filterMin; tap <= filterMax; ++tap)
+        {
+            const float weight = weights[tap];
+            if (weight == 0.0f)
+                continue;
+
+            const size_t shift = size_t(((tap % n) + n) % n) * innerCount;
+            for (size_t i = 0; i < blockSize - shift; ++i)
+                out[i] += weight * in[i + shift];
+            for (size_t i = blockSize - shift; i < blockSize; ++i)
+                out[i] += weight * in[i + shift - blockSize];
+        }
+    }
+}
+
+// The DFT along one axis, of only the frequencies in [-K, K], as cos and sin tables indexed [k + K][position]
+struct PartialDFT
+{
+    PartialDFT(int n, int K)
+        : m_n(n), m_K(K), m_cos(size_t(2 * K + 1) * n), m_sin(size_t(2 * K + 1) * n)
+    {
+        for (int k = -K; k <= K; ++k)
+        {
+            for (int p = 0; p < n; ++p)
+            {
+                // The product is reduced mod n first so the angle stays exact for big textures
+                double angle = 2.0 * 3.14159265358979323846 * double((size_t(k + n) * p) % n) / double(n);
+                m_cos[size_t(k + K) * n + p] = (float)std::cos(angle);
+                m_sin[size_t(k + K) * n + p] = (float)-std::sin(angle);
+            }
+        }
+    }
+
+    int m_n;
+    int m_K;
+    std::vector<float> m_cos;
+    std::vector<float> m_sin;
+};
+
+NoiseMetrics CalculateMetrics(const fastnoise::Context::ContextInput& settings, const std::vector<float>& filter, const float* pixels, unsigned int seed, ThreadPool* threadPool)
+{
+    const int width = (int)settings.variable_TextureSize[0];
+    const int height = (int)settings.variable_TextureSize[1];
+    const int depth = (int)settings.variable_TextureSize[2];
+    const size_t pixelCount = size_t(width) * height * depth;
+    const fastnoise::SampleSpace sampleSpace = settings.variable_sampleSpace;
+    const int components = SampleSpaceComponents(sampleSpace);
+
+    // The masks, made up front so they don't depend on the thread count
+    std::vector<Heaviside> masks(c_maskCount);
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> pixelDist(0, pixelCount - 1);
+        std::uniform_real_distribution<float> dist01(0.0f, 1.0f);
+        std::normal_distribution<float> normalDist;
+        for (Heaviside& mask : masks)
+        {
+            const float* value = &pixels[pixelDist(rng) * 4];
+            if (sampleSpace == fastnoise::SampleSpace::Circle)
+            {
+                mask.direction[0] = 1.0f;
+                mask.threshold = value[0];
+                mask.length = dist01(rng);
+                continue;
+            }
+
+            for (int i = 0; i < components; ++i)
+            {
+                mask.direction[i] = (components > 1) ? normalDist(rng) : 1.0f;
+                mask.threshold += mask.direction[i] * value[i];
+            }
+        }
+    }
+
+    // Low frequencies are up to 1/8 cycles per pixel, so up to size / 8 cycles on each axis
+    const PartialDFT dfts[3] = { PartialDFT(width, width / 8), PartialDFT(height, height / 8), PartialDFT(depth, depth / 8) };
+    const int Kx = dfts[0].m_K;
+    const int Ky = dfts[1].m_K;
+    const int Kz = dfts[2].m_K;
+    const int countX = 2 * Kx + 1;
+    const int countY = 2 * Ky + 1;
+    const int countZ = 2 * Kz + 1;
+
+    // Shells of frequency magnitude, 1 / (longest axis) apart
+    const int binsPerUnit = std::max(width, std::max(height, depth));
+    const int shellCount = binsPerUnit / 8 + 1;
+
+    struct MaskResult
+    {
+        bool valid = false;
+        double filteredVariance = 0.0;
+        std::vector<double> shellPower;
+        std::vector<int> shellFrequencies;
+    };
+    std::vector<MaskResult> results(c_maskCount);
+
+    // Scratch memory for each thread, made the first time the thread takes a mask
+    struct Scratch
+    {
+        std::vector<float> mask;
+        std::vector<float> temp;
+        std::vector<float> filtered;
+        std::vector<float> rowsRe;
+        std::vector<float> rowsIm;
+        std::vector<float> planesRe;
+        std::vector<float> planesIm;
+    };
+    std::vector<Scratch> allScratch(threadPool ? threadPool->GetThreadCount() + 1 : 1);
+
+    auto processMask = [&](int maskIndex, int threadIndex)
+    {
+        Scratch& scratch = allScratch[threadIndex];
+        if (scratch.mask.empty())
+        {
+            scratch.mask.resize(pixelCount);
+            scratch.temp.resize(pixelCount);
+            scratch.filtered.resize(pixelCount);
+            scratch.rowsRe.resize(size_t(height) * depth * countX);
+            scratch.rowsIm.resize(size_t(height) * depth * countX);
+            scratch.planesRe.resize(size_t(depth) * countY * countX);
+            scratch.planesIm.resize(size_t(depth) * countY * countX);
+        }
+        std::vector<float>& mask = scratch.mask;
+        std::vector<float>& temp = scratch.temp;
+        std::vector<float>& filtered = scratch.filtered;
+        std::vector<float>& rowsRe = scratch.rowsRe;
+        std::vector<float>& rowsIm = scratch.rowsIm;
+        std::vector<float>& planesRe = scratch.planesRe;
+        std::vector<float>& planesIm = scratch.planesIm;
+
+        const Heaviside& heaviside = masks[maskIndex];
+        MaskResult& result = results[maskIndex];
+
+        // The 0/1 mask, with its mean taken out
+        size_t inMask = 0;
+        for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+        {
+            const float* value = &pixels[pixel * 4];
+            bool in;
+            if (sampleSpace == fastnoise::SampleSpace::Circle)
+            {
+                float distance = value[0] - heaviside.threshold;
+                if (distance < 0.0f)
+                    distance += 1.0f;
+                in = distance < heaviside.length;
+            }
+            else
+            {
+                float dot = 0.0f;
+                for (int i = 0; i < components; ++i)
+                    dot += heaviside.direction[i] * value[i];
+                in = dot < heaviside.threshold;
+            }
+            mask[pixel] = in ? 1.0f : 0.0f;
+            inMask += in ? 1 : 0;
+        }
+
+        if (inMask == 0 || inMask == pixelCount)
+            return;
+
+        const float mean = float(double(inMask) / double(pixelCount));
+        const double variance = double(mean) * (1.0 - double(mean));
+        for (float& value : mask)
+            value -= mean;
+
+        // The filtered error: the filter buffer holds the autocorrelation of each axis' filter, so the variance of the filtered
+        // mask is the sum over pixels of the mask times the mask filtered by it, combined as in combineFilter() in loss.hlsl
+        const float* weightsX = &filter[settings.variable_filterOffset[0]];
+        const float* weightsY = &filter[settings.variable_filterOffset[1]];
+        const float* weightsZ = &filter[settings.variable_filterOffset[2]];
+        FilterAxis(mask.data(), temp.data(), height * depth, width, 1, settings.variable_filterMin[0], settings.variable_filterMax[0], weightsX);
+        FilterAxis(temp.data(), filtered.data(), depth, height, width, settings.variable_filterMin[1], settings.variable_filterMax[1], weightsY);
+        if (settings.variable_separate)
+        {
+            FilterAxis(mask.data(), temp.data(), 1, depth, width * height, settings.variable_filterMin[2], settings.variable_filterMax[2], weightsZ);
+            const float spatialWeight = settings.variable_separateWeight;
+            for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+                filtered[pixel] = spatialWeight * filtered[pixel] + (1.0f - spatialWeight) * temp[pixel];
+        }
+        else
+        {
+            FilterAxis(filtered.data(), temp.data(), 1, depth, width * height, settings.variable_filterMin[2], settings.variable_filterMax[2], weightsZ);
+            filtered.swap(temp);
+        }
+
+        double filteredVariance = 0.0;
+        for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+            filteredVariance += double(mask[pixel]) * double(filtered[pixel]);
+        result.filteredVariance = std::max(filteredVariance / double(pixelCount), 0.0);
+
+        // The low frequencies, an axis at a time: x for each row, then y for each slice, then z
+        const int rowCount = height * depth;
+        for (int row = 0; row < rowCount; ++row)
+        {
+            const float* in = &mask[size_t(row) * width];
+            for (int k = 0; k < countX; ++k)
+            {
+                const float* cosTable = &dfts[0].m_cos[size_t(k) * width];
+                const float* sinTable = &dfts[0].m_sin[size_t(k) * width];
+                float re = 0.0f;
+                float im = 0.0f;
+                for (int x = 0; x < width; ++x)
+                {
+                    re += in[x] * cosTable[x];
+                    im += in[x] * sinTable[x];
+                }
+                rowsRe[size_t(row) * countX + k] = re;
+                rowsIm[size_t(row) * countX + k] = im;
+            }
+        }
+
+        std::fill(planesRe.begin(), planesRe.end(), 0.0f);
+        std::fill(planesIm.begin(), planesIm.end(), 0.0f);
+        for (int z = 0; z < depth; ++z)
+        {
+            for (int y = 0; y < height; ++y)
+            {
+                const float* inRe = &rowsRe[(size_t(z) * height + y) * countX];
+                const float* inIm = &rowsIm[(size_t(z) * height + y) * countX];
+                for (int k = 0; k < countY; ++k)
+                {
+                    const float c = dfts[1].m_cos[size_t(k) * height + y];
+                    const float s = dfts[1].m_sin[size_t(k) * height + y];
+                    float* outRe = &planesRe[(size_t(z) * countY + k) * countX];
+                    float* outIm = &planesIm[(size_t(z) * countY + k) * countX];
+                    for (int kx = 0; kx < countX; ++kx)
+                    {
+                        outRe[kx] += inRe[kx] * c - inIm[kx] * s;
+                        outIm[kx] += inRe[kx] * s + inIm[kx] * c;
+                    }
+                }
+            }
+        }
+
+        result.shellPower.assign(shellCount, 0.0);
+        result.shellFrequencies.assign(shellCount, 0);
+        const size_t planeSize = size_t(countY) * countX;
+        for (int kz = 0; kz < countZ; ++kz)
+        {
+            for (size_t i = 0; i < planeSize; ++i)
+            {
+                const int ky = int(i / countX);
+                const int kx = int(i % countX);
+                const double fx = double(kx - Kx) / width;
+                const double fy = double(ky - Ky) / height;
+                const double fz = double(kz - Kz) / depth;
+                const double frequency = std::sqrt(fx * fx + fy * fy + fz * fz);
+                if (frequency == 0.0 || frequency > 0.125)
+                    continue;
+
+                double re = 0.0;
+                double im = 0.0;
+                for (int z = 0; z < depth; ++z)
+                {
+                    const double c = dfts[2].m_cos[size_t(kz) * depth + z];
+                    const double s = dfts[2].m_sin[size_t(kz) * depth + z];
+                    const double inRe = planesRe[size_t(z) * planeSize + i];
+                    const double inIm = planesIm[size_t(z) * planeSize + i];
+                    re += inRe * c - inIm * s;
+                    im += inRe * s + inIm * c;
+                }
+
+                const int shell = std::min((int)std::floor(frequency * binsPerUnit + 0.5), shellCount - 1);
+                result.shellPower[shell] += (re * re + im * im) / (double(pixelCount) * variance);
+                result.shellFrequencies[shell]++;
+            }
+        }
+
+        result.valid = true;
+    };
+
+    if (threadPool)
+    {
+        threadPool->ParallelFor(c_maskCount, processMask);
+    }
+    else
+    {
+        for (int maskIndex = 0; maskIndex < c_maskCount; ++maskIndex)
+            processMask(maskIndex, 0);
+    }
+
+    // Average over the masks, in order. The low frequency power is the mean over the shells of each shell's mean.
+    NoiseMetrics ret;
+    int validCount = 0;
+    std::vector<double> shellPower(shellCount, 0.0);
+    std::vector<int> shellFrequencies(shellCount, 0);
+    for (const MaskResult& result : results)
+    {
+        if (!result.valid)
+            continue;
+        validCount++;
+        ret.filteredErrorRMS += result.filteredVariance;
+        for (int shell = 0; shell < shellCount; ++shell)
+        {
+            shellPower[shell] += result.shellPower[shell];
+            shellFrequencies[shell] += result.shellFrequencies[shell];
+        }
+    }
+
+    if (validCount > 0)
+        ret.filteredErrorRMS = std::sqrt(ret.filteredErrorRMS / validCount);
+
+    int shellsUsed = 0;
+    for (int shell = 0; shell < shellCount; ++shell)
+    {
+        if (shellFrequencies[shell] == 0)
+            continue;
+        ret.lowFrequencyPower += shellPower[shell] / shellFrequencies[shell];
+        shellsUsed++;
+    }
+    if (shellsUsed > 0)
+        ret.lowFrequencyPower /= shellsUsed;
+
+    return ret;
+}
@@ -0,0 +1,31 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "fastnoise/public/technique.h"
+#include <vector>
+
+class ThreadPool;
+
+// Quality measures cheap enough to take every so many steps while optimizing, for -metrics. Both are averages over a few
+// random Heaviside functions of the sample space, each splitting the texture into a 0/1 mask, the way the analysis scripts
+// measure the noise. The masks are made from seed, so with the same seed every call uses the same ones, and a curve of the
+// metrics over the optimization shows the noise changing rather than the masks.
+struct NoiseMetrics
+{
+    // The RMS error of the masks filtered by the filter being optimized for. This is the same filter, and the same
+    // combining of the spatial and temporal parts, that the loss uses. Lower is better.
+    double filteredErrorRMS = 0.0;
+
+    // The masks' power at frequencies up to 1/8 cycles per pixel, radially averaged, relative to white noise. White noise
+    // is 1, and blue noise is below it.
+    double lowFrequencyPower = 0.0;
+};
+
+// pixels are the RGBA F32 texture as read back from the GPU: textureSize.x wide and textureSize.y * textureSize.z tall.
+// filter is the filter buffer built in main.cpp, indexed with filterMin / filterMax / filterOffset.
+// The masks are spread over the thread pool, or done on the calling thread without one.
+NoiseMetrics CalculateMetrics(const fastnoise::Context::ContextInput& settings, const std::vector<float>& filter, const float* pixels, unsigned int seed, ThreadPool* threadPool = nullptr);
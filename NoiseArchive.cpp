@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "NoiseArchive.h"
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+template <size_t N>
+static void CopyKeyString(char (&dest)[N], const char* src)
+{
+    memset(dest, 0, N);
+    if (!src)
+        return;
+    for (size_t i = 0; i < N - 1 && src[i]; ++i)
+        dest[i] = (char)tolower((unsigned char)src[i]);
+}
+
+template <size_t N>
+static int CompareKeyStrings(const char (&a)[N], const char (&b)[N])
+{
+    for (size_t i = 0; i < N; ++i)
+    {
+        int ca = tolower((unsigned char)a[i]);
+        int cb = tolower((unsigned char)b[i]);
+        if (ca != cb)
+            return ca - cb;
+        if (!ca)
+            return 0;
+    }
+    return 0;
+}
+
+static int CompareU32(uint32_t a, uint32_t b)
+{
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+NoiseArchive::Key NoiseArchive::MakeKey(const char* sampleSpace, const char* distribution, const char* filterXY, const char* filterZ, const char* combine, uint32_t width, uint32_t height, uint32_t depth)
+{
+    Key key;
+    CopyKeyString(key.sampleSpace, sampleSpace);
+    CopyKeyString(key.distribution, distribution);
+    CopyKeyString(key.filterXY, filterXY);
+    CopyKeyString(key.filterZ, filterZ);
+    CopyKeyString(key.combine, combine);
+    key.width = width;
+    key.height = height;
+    key.depth = depth;
+    return key;
+}
+
+int NoiseArchive::Compare(const Key& a, const Key& b)
+{
+    int ret = 0;
+    if (!ret) ret = CompareKeyStrings(a.sampleSpace, b.sampleSpace);
+    if (!ret) ret = CompareKeyStrings(a.distribution, b.distribution);
+    if (!ret) ret = CompareKeyStrings(a.filterXY, b.filterXY);
+    if (!ret) ret = CompareKeyStrings(a.filterZ, b.filterZ);
+    if (!ret) ret = CompareKeyStrings(a.combine, b.combine);
+    if (!ret) ret = CompareU32(a.width, b.width);
+    if (!ret) ret = CompareU32(a.height, b.height);
+    if (!ret) ret = CompareU32(a.depth, b.depth);
+    return ret;
+}
+
+void NoiseArchive::Close()
+{
+    m_file.Close();
+    m_entries = nullptr;
+    m_entryCount = 0;
+}
+
+bool NoiseArchive::Open(const char* fileName, char* error, size_t errorSize)
+{
+    Close();
+    error[0] = 0;
+
+    // The index is read on every lookup, so the file is mapped for random access
+    if (m_file.Open(fileName, false) != MappedFile::Result::OK)
+    {
+        sprintf_s(error, errorSize, "Could not open and map noise archive \"%s\".", fileName);
+        return false;
+    }
+
+    Header header;
+    if (m_file.GetSize() < sizeof(header) || memcmp(m_file.GetData(), "FNPK", 4))
+    {
+        sprintf_s(error, errorSize, "\"%s\" is not a noise archive.", fileName);
+        Close();
+        return false;
+    }
+
+    memcpy(&header, m_file.GetData(), sizeof(header));
+    if (header.version != c_version)
+    {
+        sprintf_s(error, errorSize, "noise archive \"%s\" is version %u, not %u.", fileName, header.version, c_version);
+        Close();
+        return false;
+    }
+
+    // Only the index is checked, so opening doesn't fault in any payload pages
+    const size_t fileSize = m_file.GetSize();
+    if ((fileSize - sizeof(header)) / sizeof(Entry) < header.entryCount)
+    {
+        sprintf_s(error, errorSize, "noise archive \"%s\" is truncated: the index has %u entries.", fileName, header.entryCount);
+        Close();
+        return false;
+    }
+
+    const Entry* entries = (const Entry*)(m_file.GetData() + sizeof(header));
+    for (uint32_t index = 0; index < header.entryCount; ++index)
+    {
+        if (entries[index].offset > fileSize || entries[index].size > fileSize - entries[index].offset)
+        {
+            sprintf_s(error, errorSize, "noise archive \"%s\" is truncated: entry %u is past the end of the file.", fileName, index);
+            Close();
+            return false;
+        }
+    }
+
+    m_entries = entries;
+    m_entryCount = header.entryCount;
+    return true;
+}
+
+NoiseArchive::View NoiseArchive::GetView(uint32_t index) const
+{
+    View view;
+    view.entry = &m_entries[index];
+    view.data = m_file.GetData() + view.entry->offset;
+    view.size = (size_t)view.entry->size;
+    return view;
+}
+
+bool NoiseArchive::Find(const Key& key, View& view) const
+{
+    const Entry* end = m_entries + m_entryCount;
+    const Entry* entry = std::lower_bound(m_entries, end, key,
+        [](const Entry& entry, const Key& key)
+        {
+            return Compare(entry.key, key) < 0;
+        }
+    );
+
+    if (entry == end || Compare(entry->key, key) != 0)
+        return false;
+
+    view = GetView(uint32_t(entry - m_entries));
+    return true;
+}
@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// A packed library of noise textures, as written by tools/noisepack, and a reader for it. The archive is memory
+// mapped and textures are returned as views into the mapping, so nothing is decoded or copied: loading a texture
+// costs the page faults of touching its texels.
+//
+// The file is a header, then an index of entries sorted by key, then the payloads. Each payload starts on a
+// c_alignment boundary and is texel data ready to upload, laid out like D3D12_SUBRESOURCE_DATA: depth slices
+// of slicePitch bytes, each of height rows of rowPitch bytes (rows of 4x4 blocks for BC formats).
+//
+// Keys are the FastNoise command line settings a texture was made with. String fields are lower case, zero
+// padded, and empty for a purely spatial texture's filterZ and combine. Matching is case insensitive.
+class NoiseArchive
+{
+public:
+    static const uint32_t c_version = 1;
+    static const uint32_t c_alignment = 4096;
+
+    struct Header
+    {
+        char magic[4];          // "FNPK"
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t alignment;
+    };
+
+    struct Key
+    {
+        char sampleSpace[16];   // real, circle, vector2, vector3, vector4, sphere
+        char distribution[16];  // uniform, tent, coshemi, ...
+        char filterXY[32];      // box3x3, gauss1_0, binomial5x5, ...
+        char filterZ[32];       // exp0101, gauss10, ... or empty
+        char combine[32];       // product, separate05, ... or empty
+        uint32_t width;
+        uint32_t height;
+        uint32_t depth;
+    };
+
+    struct Entry
+    {
+        Key key;
+        uint32_t dxgiFormat;    // A DXGI_FORMAT value
+        uint32_t rowPitch;
+        uint32_t slicePitch;
+        uint64_t offset;        // From the start of the file
+        uint64_t size;
+    };
+
+    struct View
+    {
+        const Entry* entry = nullptr;
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+    };
+
+    // Fills in a key, lower casing and truncating the strings to fit. filterZ and combine may be null.
+    static Key MakeKey(const char* sampleSpace, const char* distribution, const char* filterXY, const char* filterZ, const char* combine, uint32_t width, uint32_t height, uint32_t depth);
+
+    // The order of the index. Negative, zero or positive like strcmp.
+    static int Compare(const Key& a, const Key& b);
+
+    // Maps the archive and checks the header and index. error describes a failure.
+    bool Open(const char* fileName, char* error, size_t errorSize);
+    void Close();
+
+    uint32_t GetEntryCount() const { return m_entryCount; }
+    const Entry& GetEntry(uint32_t index) const { return m_entries[index]; }
+    View GetView(uint32_t index) const;
+
+    // A binary search of the index. Returns false if there is no texture with that key.
+    bool Find(const Key& key, View& view) const;
+
+private:
+    MappedFile m_file;
+    const Entry* m_entries = nullptr;
+    uint32_t m_entryCount = 0;
+};
+
+static_assert(sizeof(NoiseArchive::Header) == 16, "NoiseArchive::Header is part of the file format");
+static_assert(sizeof(NoiseArchive::Key) == 140, "NoiseArchive::Key is part of the file format");
+static_assert(sizeof(NoiseArchive::Entry) == 168, "NoiseArchive::Entry is part of the file format");
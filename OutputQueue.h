@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SImage.h"
+#include "ThreadPool.h"
+#include "VolumeTexture.h"
+#include <memory>
+#include <string>
+
+// Saves images on worker threads so the optimization doesn't wait for them to encode.
+// Each save takes a CPU copy of the pixels, so the image can be read back into again right away.
+// The copies waiting to be written are limited to a memory budget: when it is full, queueing another save waits for earlier ones to finish.
+class OutputQueue
+{
+public:
+    OutputQueue(size_t budgetBytes, int threadCount = 0)
+        : m_budgetBytes(budgetBytes)
+        , m_threadPool(threadCount)
+    {
+    }
+
+    ~OutputQueue()
+    {
+        Flush();
+    }
+
+    void Save(const SImage& image, const char* fileName, SImage::PixelConversions pixelConversion)
+    {
+        std::shared_ptr<SImage> snapshot = Snapshot(image);
+        std::string fileNameCopy = fileName;
+        m_threadPool.Submit(
+            [this, snapshot, fileNameCopy, pixelConversion]()
+            {
+                if (!snapshot->Save(fileNameCopy.c_str(), pixelConversion, &m_threadPool))
+                    printf("[Error] Could not save \"%s\"\n", fileNameCopy.c_str());
+            }
+        );
+    }
+
+    // Saves horizontal bands of sliceHeight rows as a file each. The slices of one copy are encoded in parallel on the same worker threads.
+    void SaveSlices(const SImage& image, const std::vector<std::string>& fileNames, int sliceHeight, SImage::PixelConversions pixelConversion)
+    {
+        std::shared_ptr<SImage> snapshot = Snapshot(image);
+        m_threadPool.Submit(
+            [this, snapshot, fileNames, sliceHeight, pixelConversion]()
+            {
+                if (!snapshot->SaveSlices(fileNames, sliceHeight, pixelConversion, m_threadPool))
+                    printf("[Error] Could not save all slices of \"%s\"\n", fileNames.empty() ? "" : fileNames[0].c_str());
+            }
+        );
+    }
+
+    // Saves horizontal bands of sliceHeight rows as the parts of one multi-part EXR
+    void SaveEXRParts(const SImage& image, const char* fileName, int sliceHeight)
+    {
+        std::shared_ptr<SImage> snapshot = Snapshot(image);
+        std::string fileNameCopy = fileName;
+        m_threadPool.Submit(
+            [this, snapshot, fileNameCopy, sliceHeight]()
+            {
+                if (!snapshot->SaveEXRParts(fileNameCopy.c_str(), sliceHeight, &m_threadPool))
+                    printf("[Error] Could not save \"%s\"\n", fileNameCopy.c_str());
+            }
+        );
+    }
+
+    // Saves the image as a volume texture of the given depth, with the slices stacked vertically as FastNoise lays them out
+    void SaveVolume(const SImage& image, const char* fileName, int depth, VolumeTexture::Container container, VolumeTexture::Format format)
+    {
+        std::shared_ptr<SImage> snapshot = Snapshot(image);
+        std::string fileNameCopy = fileName;
+        m_threadPool.Submit(
+            [this, snapshot, fileNameCopy, depth, container, format]()
+            {
+                if (!VolumeTexture::Save(fileNameCopy.c_str(), (const float*)snapshot->m_pixels.data(), snapshot->m_width, snapshot->m_height / depth, depth, container, format, &m_threadPool))
+                    printf("[Error] Could not save \"%s\"\n", fileNameCopy.c_str());
+            }
+        );
+    }
+
+    // Blocks until everything queued has been written
+    void Flush()
+    {
+        m_threadPool.Wait();
+    }
+
+    // For other CPU work to share the threads with the saves
+    ThreadPool& GetThreadPool()
+    {
+        return m_threadPool;
+    }
+
+private:
+    // Copies the CPU pixels of an image once there is room in the budget. The budget is given back when the last save using the copy finishes.
+    std::shared_ptr<SImage> Snapshot(const SImage& image)
+    {
+        size_t bytes = image.m_pixels.size();
+        {
+            // A single image larger than the whole budget is allowed through once nothing else is queued
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_bytesReleased.wait(lock, [this, bytes]() { return m_bytesInUse == 0 || m_bytesInUse + bytes <= m_budgetBytes; });
+            m_bytesInUse += bytes;
+        }
+
+        SImage* snapshot = new SImage;
+        snapshot->CopyCPUData(image);
+
+        return std::shared_ptr<SImage>(snapshot,
+            [this, bytes](SImage* snapshot)
+            {
+                delete snapshot;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_bytesInUse -= bytes;
+                }
+                m_bytesReleased.notify_all();
+            }
+        );
+    }
+
+    size_t m_budgetBytes = 0;
+    size_t m_bytesInUse = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_bytesReleased;
+
+    // Declared last so its threads are joined before the members above go away
+    ThreadPool m_threadPool;
+};
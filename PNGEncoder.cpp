@@ -0,0 +1,354 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#define NOMINMAX
+#define _CRT_SECURE_NO_WARNINGS
+#include "PNGEncoder.h"
+#include "PixelConversion.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <miniz.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace PNGEncoder
+{
+    static const char* c_filterNames[] = { "none", "sub", "up", "average", "paeth", "adaptive" };
+
+    static unsigned char Paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+            return (unsigned char)a;
+        if (pb <= pc)
+            return (unsigned char)b;
+        return (unsigned char)c;
+    }
+
+    // Writes the filter type byte and the filtered row to dest. prevRow is null for the first row of the image.
+    static void FilterRow(unsigned char* dest, const unsigned char* row, const unsigned char* prevRow, int rowBytes, int bpp, Filter filter)
+    {
+        dest[0] = (unsigned char)filter;
+        unsigned char* out = dest + 1;
+        for (int i = 0; i < rowBytes; ++i)
+        {
+            int a = (i >= bpp) ? row[i - bpp] : 0;
+            int b = prevRow ? prevRow[i] : 0;
+            int c = (prevRow && i >= bpp) ? prevRow[i - bpp] : 0;
+            switch (filter)
+            {
+                case Filter::Sub: out[i] = (unsigned char)(row[i] - a); break;
+                case Filter::Up: out[i] = (unsigned char)(row[i] - b); break;
+                case Filter::Average: out[i] = (unsigned char)(row[i] - ((a + b) >> 1)); break;
+                case Filter::Paeth: out[i] = (unsigned char)(row[i] - Paeth(a, b, c)); break;
+                default: out[i] = row[i]; break;
+            }
+        }
+    }
+
+    // Sum of the filtered bytes as signed values. Smaller tends to deflate better.
+    static unsigned int FilterCost(const unsigned char* filtered, int rowBytes)
+    {
+        unsigned int cost = 0;
+        for (int i = 0; i < rowBytes; ++i)
+            cost += std::abs((int)(signed char)filtered[i]);
+        return cost;
+    }
+
+    // Filters rowCount rows starting at rows. prevRow is the row above the first one, or null at the top of the image.
+    static void FilterRows(unsigned char* dest, const unsigned char* rows, const unsigned char* prevRow, int rowCount, int rowBytes, int bpp, Filter filter)
+    {
+        std::vector<unsigned char> candidate(filter == Filter::Adaptive ? rowBytes + 1 : 0);
+        for (int row = 0; row < rowCount; ++row)
+        {
+            const unsigned char* src = &rows[size_t(row) * rowBytes];
+            const unsigned char* prevSrc = (row > 0) ? src - rowBytes : prevRow;
+            unsigned char* out = &dest[size_t(row) * (rowBytes + 1)];
+
+            if (filter != Filter::Adaptive)
+            {
+                FilterRow(out, src, prevSrc, rowBytes, bpp, filter);
+                continue;
+            }
+
+            unsigned int bestCost = ~0u;
+            for (int f = (int)Filter::None; f <= (int)Filter::Paeth; ++f)
+            {
+                FilterRow(candidate.data(), src, prevSrc, rowBytes, bpp, (Filter)f);
+                unsigned int cost = FilterCost(candidate.data() + 1, rowBytes);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    memcpy(out, candidate.data(), rowBytes + 1);
+                }
+            }
+        }
+    }
+
+    static mz_bool AppendToVector(const void* buf, int len, void* user)
+    {
+        std::vector<unsigned char>& out = *(std::vector<unsigned char>*)user;
+        out.insert(out.end(), (const unsigned char*)buf, (const unsigned char*)buf + len);
+        return MZ_TRUE;
+    }
+
+    // The adler32 of two pieces of data joined together, from the adler32 of each, as adler32_combine() in zlib does
+    static mz_ulong Adler32Combine(mz_ulong adler1, mz_ulong adler2, size_t length2)
+    {
+        static const mz_ulong c_base = 65521;
+        mz_ulong rem = (mz_ulong)(length2 % c_base);
+        mz_ulong sum1 = adler1 & 0xffff;
+        mz_ulong sum2 = (rem * sum1) % c_base;
+        sum1 += (adler2 & 0xffff) + c_base - 1;
+        sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + c_base - rem;
+        if (sum1 >= c_base) sum1 -= c_base;
+        if (sum1 >= c_base) sum1 -= c_base;
+        if (sum2 >= (c_base << 1)) sum2 -= (c_base << 1);
+        if (sum2 >= c_base) sum2 -= c_base;
+        return sum1 | (sum2 << 16);
+    }
+
+    struct Strip
+    {
+        std::vector<unsigned char> deflated;
+        mz_ulong adler = MZ_ADLER32_INIT;
+        size_t filteredSize = 0;
+        bool success = false;
+    };
+
+    // Where the rows come from: 8 bit pixels as they are, or float pixels converted a strip at a time
+    struct Source
+    {
+        const unsigned char* u8 = nullptr;
+        const float* f32 = nullptr;
+        int width = 0;
+        int srcComponents = 0;
+        int components = 0;
+    };
+
+    // Per thread buffers, reused from strip to strip
+    struct Scratch
+    {
+        std::vector<unsigned char> converted;
+        std::vector<unsigned char> filtered;
+    };
+
+    // Filters and deflates one strip of rows into raw deflate data. Strips other than the last end with a full flush so they can be concatenated.
+    static bool CompressStrip(Strip& strip, Scratch& scratch, const Source& source, int rowStart, int rowEnd, int rowBytes, bool lastStrip, const Settings& settings)
+    {
+        // The strip's rows, and the row above them for the filters to look at
+        const unsigned char* rows;
+        const unsigned char* prevRow;
+        if (source.f32)
+        {
+            int convertStart = (rowStart > 0) ? rowStart - 1 : 0;
+            size_t srcRowValues = size_t(source.width) * source.srcComponents;
+            scratch.converted.resize(size_t(rowEnd - convertStart) * rowBytes);
+            Trace::Scope scope("convert");
+            PixelConversion::F32ToU8(scratch.converted.data(), &source.f32[convertStart * srcRowValues], size_t(rowEnd - convertStart) * source.width, source.srcComponents, source.components);
+            rows = &scratch.converted[size_t(rowStart - convertStart) * rowBytes];
+        }
+        else
+        {
+            rows = &source.u8[size_t(rowStart) * rowBytes];
+        }
+        prevRow = (rowStart > 0) ? rows - rowBytes : nullptr;
+
+        std::vector<unsigned char>& filtered = scratch.filtered;
+        {
+            Trace::Scope scope("filter");
+            filtered.resize(size_t(rowEnd - rowStart) * (rowBytes + 1));
+            FilterRows(filtered.data(), rows, prevRow, rowEnd - rowStart, rowBytes, source.components, settings.filter);
+            strip.adler = mz_adler32(MZ_ADLER32_INIT, filtered.data(), filtered.size());
+            strip.filteredSize = filtered.size();
+        }
+
+        Trace::Scope scope("deflate");
+
+        // The compressor is a few hundred KB, too big for the stack
+        std::unique_ptr<tdefl_compressor> compressor = std::make_unique<tdefl_compressor>();
+        mz_uint flags = tdefl_create_comp_flags_from_zip_params(settings.compressionLevel, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+        if (tdefl_init(compressor.get(), AppendToVector, &strip.deflated, flags) != TDEFL_STATUS_OKAY)
+            return false;
+
+        tdefl_status status = tdefl_compress_buffer(compressor.get(), filtered.data(), filtered.size(), lastStrip ? TDEFL_FINISH : TDEFL_FULL_FLUSH);
+        return status == (lastStrip ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY);
+    }
+
+    static void AppendU32(std::vector<unsigned char>& out, mz_ulong value)
+    {
+        out.push_back((unsigned char)(value >> 24));
+        out.push_back((unsigned char)(value >> 16));
+        out.push_back((unsigned char)(value >> 8));
+        out.push_back((unsigned char)(value));
+    }
+
+    static void AppendChunk(std::vector<unsigned char>& png, const char* type, const unsigned char* data, size_t size)
+    {
+        AppendU32(png, (mz_ulong)size);
+        size_t crcStart = png.size();
+        png.insert(png.end(), type, type + 4);
+        if (size > 0)
+            png.insert(png.end(), data, data + size);
+        AppendU32(png, mz_crc32(MZ_CRC32_INIT, &png[crcStart], size + 4));
+    }
+
+    bool FilterFromString(const char* name, Filter& filter)
+    {
+        for (int i = 0; i < (int)_countof(c_filterNames); ++i)
+        {
+            if (!_stricmp(name, c_filterNames[i]))
+            {
+                filter = (Filter)i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool Encode(std::vector<unsigned char>& png, const Source& source, int height, const Settings& settings)
+    {
+        static const unsigned char c_colorTypes[] = { 0, 0, 4, 2, 6 };
+        const int width = source.width;
+        const int components = source.components;
+        if (width <= 0 || height <= 0 || components < 1 || components > 4 || (source.f32 && components > source.srcComponents))
+            return false;
+
+        const int rowBytes = width * components;
+
+        // Split the rows into strips
+        int stripRows = settings.stripRows;
+        if (stripRows <= 0)
+        {
+            // Enough strips to keep every thread busy, but not so small that the flushes hurt compression
+            static const size_t c_minStripBytes = 64 * 1024;
+            int threadCount = settings.threadPool ? settings.threadPool->GetThreadCount() + 1 : 1;
+            stripRows = (height + threadCount - 1) / threadCount;
+            stripRows = std::max(stripRows, (int)((c_minStripBytes + rowBytes - 1) / rowBytes));
+        }
+        stripRows = std::min(stripRows, height);
+        const int stripCount = settings.threadPool ? (height + stripRows - 1) / stripRows : 1;
+        if (stripCount == 1)
+            stripRows = height;
+
+        std::vector<Strip> strips(stripCount);
+        auto compressStrip = [&](int stripIndex, Scratch& scratch)
+        {
+            int rowStart = stripIndex * stripRows;
+            int rowEnd = std::min(rowStart + stripRows, height);
+            strips[stripIndex].success = CompressStrip(strips[stripIndex], scratch, source, rowStart, rowEnd, rowBytes, stripIndex == stripCount - 1, settings);
+        };
+
+        if (stripCount == 1)
+        {
+            Scratch scratch;
+            compressStrip(0, scratch);
+        }
+        else
+        {
+            std::vector<Scratch> scratch(settings.threadPool->GetThreadCount() + 1);
+            settings.threadPool->ParallelFor(stripCount,
+                [&](int stripIndex, int threadIndex)
+                {
+                    compressStrip(stripIndex, scratch[threadIndex]);
+                }
+            );
+        }
+
+        // The adler32 of the zlib stream covers the filtered data of all the strips
+        mz_ulong adler = MZ_ADLER32_INIT;
+        for (int i = 0; i < stripCount; ++i)
+        {
+            if (!strips[i].success)
+                return false;
+            adler = (i == 0) ? strips[i].adler : Adler32Combine(adler, strips[i].adler, strips[i].filteredSize);
+        }
+
+        // zlib stream: header, the deflated strips, adler32
+        std::vector<unsigned char> idat;
+        {
+            size_t size = 6;
+            for (const Strip& strip : strips)
+                size += strip.deflated.size();
+            idat.reserve(size);
+        }
+        idat.push_back(0x78);
+        idat.push_back(0x01);
+        for (const Strip& strip : strips)
+            idat.insert(idat.end(), strip.deflated.begin(), strip.deflated.end());
+        AppendU32(idat, adler);
+
+        // PNG file
+        static const unsigned char c_signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        png.clear();
+        png.insert(png.end(), c_signature, c_signature + sizeof(c_signature));
+
+        std::vector<unsigned char> ihdr;
+        AppendU32(ihdr, width);
+        AppendU32(ihdr, height);
+        ihdr.push_back(8);                          // bit depth
+        ihdr.push_back(c_colorTypes[components]);
+        ihdr.push_back(0);                          // compression
+        ihdr.push_back(0);                          // filter
+        ihdr.push_back(0);                          // interlace
+        AppendChunk(png, "IHDR", ihdr.data(), ihdr.size());
+        AppendChunk(png, "IDAT", idat.data(), idat.size());
+        AppendChunk(png, "IEND", nullptr, 0);
+
+        return true;
+    }
+
+    bool Encode(std::vector<unsigned char>& png, const unsigned char* pixels, int width, int height, int components, const Settings& settings)
+    {
+        Source source;
+        source.u8 = pixels;
+        source.width = width;
+        source.srcComponents = components;
+        source.components = components;
+        return Encode(png, source, height, settings);
+    }
+
+    bool EncodeF32(std::vector<unsigned char>& png, const float* pixels, int width, int height, int srcComponents, int components, const Settings& settings)
+    {
+        Source source;
+        source.f32 = pixels;
+        source.width = width;
+        source.srcComponents = srcComponents;
+        source.components = components;
+        return Encode(png, source, height, settings);
+    }
+
+    static bool WriteFile(const char* fileName, const std::vector<unsigned char>& png)
+    {
+        Trace::Scope scope("write", "io");
+
+        FILE* file = nullptr;
+        fopen_s(&file, fileName, "wb");
+        if (!file)
+            return false;
+
+        bool success = fwrite(png.data(), 1, png.size(), file) == png.size();
+        fclose(file);
+        return success;
+    }
+
+    bool Save(const char* fileName, const unsigned char* pixels, int width, int height, int components, const Settings& settings)
+    {
+        std::vector<unsigned char> png;
+        return Encode(png, pixels, width, height, components, settings) && WriteFile(fileName, png);
+    }
+
+    bool SaveF32(const char* fileName, const float* pixels, int width, int height, int srcComponents, int components, const Settings& settings)
+    {
+        std::vector<unsigned char> png;
+        return EncodeF32(png, pixels, width, height, srcComponents, components, settings) && WriteFile(fileName, png);
+    }
+}
@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+class ThreadPool;
+
+// 8 bit PNG writer built on miniz. Unlike stbi_write_png, the row filter and compression level can be chosen,
+// and the image can be split into strips of rows that are filtered and deflated in parallel. Each strip ends in
+// a full flush, which byte aligns it and makes it independent of the others, so the strips just concatenate
+// into one zlib stream. That costs a little compression per strip.
+namespace PNGEncoder
+{
+    enum class Filter
+    {
+        None,
+        Sub,
+        Up,
+        Average,
+        Paeth,
+        Adaptive,   // Per row, the filter with the lowest sum of absolute differences, like stb and libpng do
+    };
+
+    struct Settings
+    {
+        Filter filter = Filter::Adaptive;
+        int compressionLevel = 6;           // 0 (store) to 10 (slowest), as in miniz
+        int stripRows = 0;                  // Rows per parallel strip. 0 picks a size from the image and thread count.
+        ThreadPool* threadPool = nullptr;   // No thread pool means a single strip on the calling thread
+    };
+
+    // Returns the filter whose name is given, or false if there isn't one
+    bool FilterFromString(const char* name, Filter& filter);
+
+    bool Encode(std::vector<unsigned char>& png, const unsigned char* pixels, int width, int height, int components, const Settings& settings);
+    bool Save(const char* fileName, const unsigned char* pixels, int width, int height, int components, const Settings& settings);
+
+    // Float pixels of srcComponents channels, saved as the first components of them. Each strip converts its own rows with
+    // PixelConversion::F32ToU8 into a per thread buffer just before filtering them, so there is no 8 bit copy of the whole image.
+    bool EncodeF32(std::vector<unsigned char>& png, const float* pixels, int width, int height, int srcComponents, int components, const Settings& settings);
+    bool SaveF32(const char* fileName, const float* pixels, int width, int height, int srcComponents, int components, const Settings& settings);
+}
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PixelConversion.h"
+#include <emmintrin.h>
+
+namespace PixelConversion
+{
+    static unsigned char ToU8(float value)
+    {
+        value *= 256.0f;
+        // Written so a NaN fails both tests and ends up as 0
+        if (!(value < 255.0f))
+            value = (value == value) ? 255.0f : 0.0f;
+        if (!(value > 0.0f))
+            value = 0.0f;
+        return (unsigned char)value;
+    }
+
+    // 4 values to 4 int32s. _mm_max_ps returns its second operand when either is NaN, so doing it first makes NaN 0.
+    static __m128i ToI32(__m128 value)
+    {
+        value = _mm_mul_ps(value, _mm_set1_ps(256.0f));
+        value = _mm_max_ps(value, _mm_setzero_ps());
+        value = _mm_min_ps(value, _mm_set1_ps(255.0f));
+        // Truncation is floor, as the value isn't negative
+        return _mm_cvttps_epi32(value);
+    }
+
+    // 16 int32s in [0, 255] to 16 bytes
+    static __m128i Pack(__m128i a, __m128i b, __m128i c, __m128i d)
+    {
+        return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    }
+
+    // All channels: 16 values at a time
+    static size_t ConvertAll(unsigned char* dest, const float* src, size_t count)
+    {
+        size_t index = 0;
+        for (; index + 16 <= count; index += 16)
+        {
+            __m128i a = ToI32(_mm_loadu_ps(&src[index + 0]));
+            __m128i b = ToI32(_mm_loadu_ps(&src[index + 4]));
+            __m128i c = ToI32(_mm_loadu_ps(&src[index + 8]));
+            __m128i d = ToI32(_mm_loadu_ps(&src[index + 12]));
+            _mm_storeu_si128((__m128i*)&dest[index], Pack(a, b, c, d));
+        }
+        return index;
+    }
+
+    // The first channel of 4 RGBA pixels, from a 4x4 transpose
+    static __m128 FirstChannel(const float* src)
+    {
+        __m128 p0 = _mm_loadu_ps(&src[0]);
+        __m128 p1 = _mm_loadu_ps(&src[4]);
+        __m128 p2 = _mm_loadu_ps(&src[8]);
+        __m128 p3 = _mm_loadu_ps(&src[12]);
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+        return p0;
+    }
+
+    // RGBA to R: 16 pixels at a time
+    static size_t ConvertRGBAToR(unsigned char* dest, const float* src, size_t pixelCount)
+    {
+        size_t pixel = 0;
+        for (; pixel + 16 <= pixelCount; pixel += 16)
+        {
+            const float* s = &src[pixel * 4];
+            __m128i a = ToI32(FirstChannel(&s[0]));
+            __m128i b = ToI32(FirstChannel(&s[16]));
+            __m128i c = ToI32(FirstChannel(&s[32]));
+            __m128i d = ToI32(FirstChannel(&s[48]));
+            _mm_storeu_si128((__m128i*)&dest[pixel], Pack(a, b, c, d));
+        }
+        return pixel;
+    }
+
+    // RGBA to RG: 8 pixels at a time, keeping the xy half of each pair of pixels
+    static size_t ConvertRGBAToRG(unsigned char* dest, const float* src, size_t pixelCount)
+    {
+        size_t pixel = 0;
+        for (; pixel + 8 <= pixelCount; pixel += 8)
+        {
+            const float* s = &src[pixel * 4];
+            __m128i a = ToI32(_mm_movelh_ps(_mm_loadu_ps(&s[0]), _mm_loadu_ps(&s[4])));
+            __m128i b = ToI32(_mm_movelh_ps(_mm_loadu_ps(&s[8]), _mm_loadu_ps(&s[12])));
+            __m128i c = ToI32(_mm_movelh_ps(_mm_loadu_ps(&s[16]), _mm_loadu_ps(&s[20])));
+            __m128i d = ToI32(_mm_movelh_ps(_mm_loadu_ps(&s[24]), _mm_loadu_ps(&s[28])));
+            _mm_storeu_si128((__m128i*)&dest[pixel * 2], Pack(a, b, c, d));
+        }
+        return pixel;
+    }
+
+    void F32ToU8(unsigned char* dest, const float* src, size_t pixelCount, int srcComponents, int destComponents)
+    {
+        // The vector loops do what they can, and the scalar loops below finish off the remainder
+        size_t pixel = 0;
+        if (destComponents == srcComponents)
+        {
+            size_t count = pixelCount * srcComponents;
+            size_t index = ConvertAll(dest, src, count);
+            for (; index < count; ++index)
+                dest[index] = ToU8(src[index]);
+            return;
+        }
+        else if (srcComponents == 4 && destComponents == 1)
+        {
+            pixel = ConvertRGBAToR(dest, src, pixelCount);
+        }
+        else if (srcComponents == 4 && destComponents == 2)
+        {
+            pixel = ConvertRGBAToRG(dest, src, pixelCount);
+        }
+
+        for (; pixel < pixelCount; ++pixel)
+        {
+            for (int i = 0; i < destComponents; ++i)
+                dest[pixel * destComponents + i] = ToU8(src[pixel * srcComponents + i]);
+        }
+    }
+}
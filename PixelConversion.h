@@ -0,0 +1,16 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+
+namespace PixelConversion
+{
+    // Converts float pixels of srcComponents channels to 8 bit pixels of the first destComponents of those channels.
+    // Each value becomes floor(value * 256) clamped to [0, 255], so [0, 1) maps to 256 equal sized buckets. NaN becomes 0.
+    // NOTE: this DOES NOT convert from linear to sRGB
+    void F32ToU8(unsigned char* dest, const float* src, size_t pixelCount, int srcComponents, int destComponents);
+}
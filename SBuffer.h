@@ -6,6 +6,7 @@
 #pragma once
 
 #include "DX12.h"
+#include <functional>
 #include <vector>
 
 template <typename T>
@@ -23,12 +24,19 @@ struct SBuffer
 
     bool Load(ID3D12Device* device, T* data, size_t count, const char* debugName)
     {
-        m_debugName = std::wstring(CA2W(std::string(debugName).c_str()));
-
         // Copy the data
         m_data.resize(count);
         memcpy(m_data.data(), data, sizeof(T) * count);
 
+        return Create(device, count, debugName);
+    }
+
+    // Creates the GPU resource without any CPU data. Fill it with the UploadDataToGPU overload that takes a callback.
+    bool Create(ID3D12Device* device, size_t count, const char* debugName)
+    {
+        m_debugName = std::wstring(CA2W(std::string(debugName).c_str()));
+        m_count = count;
+
         // Create a resource
         D3D12_RESOURCE_DESC bufferDesc = {};
         bufferDesc.MipLevels = 1;
@@ -75,6 +83,17 @@ struct SBuffer
     }
 
     void UploadDataToGPU(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
+    {
+        UploadDataToGPU(device, cmdList,
+            [this](T* dest)
+            {
+                memcpy(dest, m_data.data(), sizeof(T) * m_data.size());
+            }
+        );
+    }
+
+    // fill writes the m_count items straight into the mapped upload heap, so the data doesn't need to be in m_data first
+    void UploadDataToGPU(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::function<void(T* dest)>& fill)
     {
         UINT64 size = 0;
         D3D12_RESOURCE_DESC desc = m_resource->GetDesc();
@@ -118,7 +137,7 @@ struct SBuffer
         {
             unsigned char* gpuBufferData = nullptr;
             ThrowIfFailed(uploadResource->Map(0, nullptr, reinterpret_cast<void**>(&gpuBufferData)));
-            memcpy(gpuBufferData, m_data.data(), sizeof(T) * m_data.size());
+            fill((T*)gpuBufferData);
             uploadResource->Unmap(0, nullptr);
         }
 
@@ -236,6 +255,7 @@ struct SBuffer
         m_releaseResource = false;
 
         m_data.resize(count);
+        m_count = count;
 
         m_resource = resource;
     }
@@ -243,6 +263,9 @@ struct SBuffer
     // CPU data
     std::vector<T> m_data;
 
+    // Number of items in the GPU resource
+    size_t m_count = 0;
+
     // GPU data
     bool m_releaseResource = true;
     ID3D12Resource* m_resource = nullptr;
@@ -10,6 +10,11 @@
 #include "fastnoise/DX12Utils/tinyexr/tinyexr.h"
 
 #include "SImage.h"
+#include "CSVWriter.h"
+#include "PixelConversion.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <atomic>
 
 #include "fastnoise/DX12Utils/stb/stb_image.h"
 
@@ -28,102 +33,322 @@ static const char* GetFileExtension(const char* fileName)
     return nullptr;
 }
 
-static bool SaveCSV(const float* pixels, int width, int height, int numChannels, const char* outfilename)
+// How many of an image's channels are saved
+static int SaveComponents(int components)
 {
-    FILE* file = nullptr;
-    fopen_s(&file, outfilename, "wb");
-    if (!file)
+    return (SImage::s_saveComponents > 0) ? std::min(SImage::s_saveComponents, components) : components;
+}
+
+static bool SaveCSV(const float* pixels, int width, int height, int numChannels, const char* outfilename, ThreadPool* threadPool)
+{
+    const int saveChannels = SaveComponents(numChannels);
+    if (!CSVWriter::Save(outfilename, pixels, width, height, numChannels, saveChannels, threadPool))
         return false;
 
-    const float* value = pixels;
-    for (int iy = 0; iy < height; ++iy)
-    {
-        for (int ix = 0; ix < width * numChannels; ++ix)
-        {
-            fprintf(file, "%s\"%f\"", ix > 0 ? "," : "", *value);
-            value++;
-        }
-        fprintf(file, "\n");
-    }
+    if (!SImage::s_writeF32Sidecar)
+        return true;
 
-    fclose(file);
-    return true;
+    std::string sidecarFileName = outfilename;
+    sidecarFileName.resize(sidecarFileName.size() - strlen(GetFileExtension(outfilename)));
+    sidecarFileName += ".f32";
+    return CSVWriter::SaveF32(sidecarFileName.c_str(), pixels, size_t(width) * height, numChannels, saveChannels);
+}
+
+// EXR files are written here a block of scanlines at a time, instead of by tinyexr, which needs the whole image split into
+// planes. tinyexr still compresses the blocks: each block's rows are split into planes of their own and saved to memory as a
+// small image, and that image's scanline chunks are copied into the file with their y moved to where the block is. So the
+// extra memory is the planes and chunks of the blocks being worked on, rather than a copy of the whole image.
+static const int c_exrBlockRows = 32;   // A whole number of chunks for every compression: 1 line for none, 16 for ZIP, 32 for PIZ
+
+static void AppendEXRAttribute(std::vector<unsigned char>& out, const char* name, const char* type, const void* data, int size)
+{
+    out.insert(out.end(), name, name + strlen(name) + 1);
+    out.insert(out.end(), type, type + strlen(type) + 1);
+    out.insert(out.end(), (const unsigned char*)&size, (const unsigned char*)&size + sizeof(size));
+    out.insert(out.end(), (const unsigned char*)data, (const unsigned char*)data + size);
 }
 
-static bool SaveEXR(const float* pixels, int width, int height, int numChannels, const char* outfilename)
+// Compresses rows [y, y + rows) of a part into its scanline chunks, each an int32 y, an int32 byte count and the data,
+// and returns how many chunks tinyexr made. header describes the file's channels, in the file's order, and compression.
+static bool EncodeEXRBlock(std::vector<unsigned char>& chunks, int& chunkCount, const float* part, int width, int y, int rows, int srcChannels, const EXRHeader& header)
 {
-    EXRHeader header;
-    InitEXRHeader(&header);
+    const int numChannels = header.num_channels;
+    const size_t blockPixels = size_t(width) * rows;
+    const float* src = &part[size_t(y) * width * srcChannels];
+
+    // Planes are in the file's channel order, which is (A)BGR because most EXR viewers expect that
+    std::vector<float> planes(blockPixels * numChannels);
+    std::vector<unsigned char*> planePointers(numChannels);
+    for (int i = 0; i < numChannels; ++i)
+    {
+        const int channel = numChannels - i - 1;
+        float* plane = &planes[i * blockPixels];
+        for (size_t pixel = 0; pixel < blockPixels; ++pixel)
+            plane[pixel] = src[pixel * srcChannels + channel];
+        planePointers[i] = (unsigned char*)plane;
+    }
 
     EXRImage image;
     InitEXRImage(&image);
-
     image.num_channels = numChannels;
+    image.width = width;
+    image.height = rows;
+    image.images = planePointers.data();
 
-    std::vector<std::vector<float>> images;
-    images.resize(numChannels);
-    for (std::vector<float>& v : images)
-        v.resize(width * height);
-
-    // Split interleaved channels into separate channels
-    for (int i = 0; i < width * height; i++)
+    unsigned char* memory = nullptr;
+    const char* err = nullptr;
+    size_t memorySize = SaveEXRImageToMemory(&image, &header, &memory, &err);
+    if (memorySize == 0)
     {
-        for (int j = 0; j < numChannels; ++j)
-            images[j][i] = pixels[numChannels * i + j];
+        FreeEXRErrorMessage(err);
+        return false;
     }
 
-    // put the RGBA channels into ABGR because most EXR viewers expect this
-    std::vector<float*> image_ptr(numChannels);
-    for (int i = 0; i < numChannels; ++i)
-        image_ptr[i] = images[numChannels - i - 1].data();
+    // Skip the magic number, version and attributes, up to the empty name that ends them
+    size_t pos = 8;
+    while (pos < memorySize && memory[pos] != 0)
+    {
+        pos += strnlen((const char*)&memory[pos], memorySize - pos) + 1;
+        pos += strnlen((const char*)&memory[pos], memorySize - pos) + 1;
+        int size = 0;
+        if (pos + sizeof(size) <= memorySize)
+            memcpy(&size, &memory[pos], sizeof(size));
+        pos += sizeof(size) + size;
+    }
+    const size_t tableStart = pos + 1;
+
+    // The offset table ends where the first chunk starts, which gives the chunk count
+    uint64_t firstOffset = 0;
+    if (tableStart + sizeof(firstOffset) <= memorySize)
+        memcpy(&firstOffset, &memory[tableStart], sizeof(firstOffset));
+    bool success = firstOffset > tableStart && firstOffset <= memorySize && (firstOffset - tableStart) % sizeof(uint64_t) == 0;
+    chunkCount = success ? int((firstOffset - tableStart) / sizeof(uint64_t)) : 0;
+    pos = size_t(firstOffset);
+
+    // The chunks follow in order, each where the table says it is, and the first one is at y = 0
+    chunks.clear();
+    for (int chunk = 0; chunk < chunkCount && success; ++chunk)
+    {
+        uint64_t chunkOffset = 0;
+        int chunkY = 0;
+        int size = 0;
+        memcpy(&chunkOffset, &memory[tableStart + chunk * sizeof(uint64_t)], sizeof(chunkOffset));
+        success = chunkOffset == pos && pos + 8 <= memorySize;
+        if (success)
+        {
+            memcpy(&chunkY, &memory[pos], sizeof(chunkY));
+            memcpy(&size, &memory[pos + 4], sizeof(size));
+            success = size >= 0 && pos + 8 + size <= memorySize && (chunk > 0 || chunkY == 0);
+        }
+        if (success)
+        {
+            chunkY += y;
+            chunks.insert(chunks.end(), (const unsigned char*)&chunkY, (const unsigned char*)&chunkY + sizeof(chunkY));
+            chunks.insert(chunks.end(), &memory[pos + 4], &memory[pos + 8 + size]);
+            pos += 8 + size;
+        }
+    }
 
-    image.images = (unsigned char**)image_ptr.data();
-    image.width = width;
-    image.height = height;
+    free(memory);
+    return success;
+}
 
-    // Must be (A)BGR order, since most of EXR viewers expect this channel order.
-    const char* chanelNames[4] = { "R", "G", "B", "A" };
-    header.num_channels = numChannels;
-    header.channels = (EXRChannelInfo*)malloc(sizeof(EXRChannelInfo) * header.num_channels);
+// Writes parts stacked vertically, each height / parts rows tall, as the parts of a multi-part EXR, or a plain EXR for a single part.
+// Blocks are compressed a batch at a time, a block per task if there is a thread pool, and written in order. Only the first
+// SaveComponents() channels are written.
+static bool SaveEXR(const float* pixels, int width, int height, int srcChannels, const char* outfilename, ThreadPool* threadPool, int parts = 1)
+{
+    const int numChannels = SaveComponents(srcChannels);
+    const int partHeight = height / parts;
+    const SImage::EXRSettings& settings = SImage::s_exrSettings;
+
+    static const int c_compressionTypes[] = { TINYEXR_COMPRESSIONTYPE_NONE, TINYEXR_COMPRESSIONTYPE_ZIP, TINYEXR_COMPRESSIONTYPE_PIZ };
+    const int compressionType = c_compressionTypes[(int)settings.compression];
+    const int blocksPerPart = (partHeight + c_exrBlockRows - 1) / c_exrBlockRows;
+    const int pixelType = settings.half ? TINYEXR_PIXELTYPE_HALF : TINYEXR_PIXELTYPE_FLOAT;
+
+    // The header that tinyexr compresses blocks with. The arrays are owned here, so there is nothing to free on any path.
+    const char* channelNames[4] = { "R", "G", "B", "A" };
+    std::vector<EXRChannelInfo> channels(numChannels);
     for (int i = 0; i < numChannels; ++i)
     {
-        char buffer[256];
-        const char* channelName;
-        if (i < 4)
+        const int channel = numChannels - i - 1;
+        if (channel < 4)
+            strcpy_s(channels[i].name, channelNames[channel]);
+        else
+            sprintf_s(channels[i].name, "X%i", channel - 4);
+    }
+    std::vector<int> pixelTypes(numChannels, TINYEXR_PIXELTYPE_FLOAT);
+    std::vector<int> requestedPixelTypes(numChannels, pixelType);
+
+    EXRHeader blockHeader;
+    InitEXRHeader(&blockHeader);
+    blockHeader.num_channels = numChannels;
+    blockHeader.channels = channels.data();
+    blockHeader.pixel_types = pixelTypes.data();
+    blockHeader.requested_pixel_types = requestedPixelTypes.data();
+    blockHeader.compression_type = compressionType;
+
+    // How many lines tinyexr puts in a chunk for this compression: the y of the second chunk of two blocks of blank rows.
+    // Blocks have to hold a whole number of chunks, or their chunks wouldn't line up with the file's.
+    int linesPerChunk = c_exrBlockRows * 2;
+    {
+        std::vector<float> blankRows(size_t(c_exrBlockRows) * 2 * numChannels, 0.0f);
+        std::vector<unsigned char> chunks;
+        int chunkCount = 0;
+        if (!EncodeEXRBlock(chunks, chunkCount, blankRows.data(), 1, 0, c_exrBlockRows * 2, numChannels, blockHeader))
+            return false;
+        if (chunkCount > 1)
         {
-            channelName = chanelNames[numChannels - i - 1];
+            int32_t size = 0;
+            memcpy(&size, &chunks[4], sizeof(size));
+            memcpy(&linesPerChunk, &chunks[8 + size], sizeof(linesPerChunk));
         }
-        else
+        if (linesPerChunk <= 0 || c_exrBlockRows % linesPerChunk != 0)
         {
-            sprintf(buffer, "X%i", i - 4);
-            channelName = buffer;
+            printf("[Error] EXR chunks for this compression don't fit in blocks of %i rows\n", c_exrBlockRows);
+            return false;
         }
-        strncpy(header.channels[i].name, channelName, 255); header.channels[0].name[strlen(channelName)] = '\0';
     }
+    const int chunksPerPart = (partHeight + linesPerChunk - 1) / linesPerChunk;
+
+    // The file's header
+    std::vector<unsigned char> fileHeader = { 0x76, 0x2f, 0x31, 0x01 };
+    const uint32_t version = 2 | ((parts > 1) ? 0x1000 : 0);
+    fileHeader.insert(fileHeader.end(), (const unsigned char*)&version, (const unsigned char*)&version + sizeof(version));
+    for (int part = 0; part < parts; ++part)
+    {
+        std::vector<unsigned char> channelList;
+        for (int i = 0; i < numChannels; ++i)
+        {
+            const int32_t channelInfo[4] = { pixelType, 0, 1, 1 }; // type, linear and reserved bytes, x and y sampling
+            channelList.insert(channelList.end(), channels[i].name, channels[i].name + strlen(channels[i].name) + 1);
+            channelList.insert(channelList.end(), (const unsigned char*)channelInfo, (const unsigned char*)channelInfo + sizeof(channelInfo));
+        }
+        channelList.push_back(0);
+        AppendEXRAttribute(fileHeader, "channels", "chlist", channelList.data(), (int)channelList.size());
+
+        const unsigned char compression = (unsigned char)compressionType;
+        AppendEXRAttribute(fileHeader, "compression", "compression", &compression, 1);
+
+        const int32_t window[4] = { 0, 0, width - 1, partHeight - 1 };
+        AppendEXRAttribute(fileHeader, "dataWindow", "box2i", window, sizeof(window));
+        AppendEXRAttribute(fileHeader, "displayWindow", "box2i", window, sizeof(window));
 
-    header.pixel_types = (int*)malloc(sizeof(int) * header.num_channels);
-    header.requested_pixel_types = (int*)malloc(sizeof(int) * header.num_channels);
-    for (int i = 0; i < header.num_channels; i++) {
-        header.pixel_types[i] = TINYEXR_PIXELTYPE_FLOAT; // pixel type of input image
-        header.requested_pixel_types[i] = TINYEXR_PIXELTYPE_FLOAT;// TINYEXR_PIXELTYPE_HALF; // pixel type of output image to be stored in .EXR
+        const unsigned char lineOrder = 0;
+        AppendEXRAttribute(fileHeader, "lineOrder", "lineOrder", &lineOrder, 1);
+
+        const float aspectRatio = 1.0f;
+        const float center[2] = { 0.0f, 0.0f };
+        const float screenWidth = 1.0f;
+        AppendEXRAttribute(fileHeader, "pixelAspectRatio", "float", &aspectRatio, sizeof(aspectRatio));
+        AppendEXRAttribute(fileHeader, "screenWindowCenter", "v2f", center, sizeof(center));
+        AppendEXRAttribute(fileHeader, "screenWindowWidth", "float", &screenWidth, sizeof(screenWidth));
+
+        if (parts > 1)
+        {
+            char name[32];
+            sprintf_s(name, "slice%i", part);
+            AppendEXRAttribute(fileHeader, "name", "string", name, (int)strlen(name));
+            AppendEXRAttribute(fileHeader, "type", "string", "scanlineimage", (int)strlen("scanlineimage"));
+            AppendEXRAttribute(fileHeader, "chunkCount", "int", &chunksPerPart, sizeof(chunksPerPart));
+        }
+        fileHeader.push_back(0);
     }
+    if (parts > 1)
+        fileHeader.push_back(0);
 
-    const char* err = NULL; // or nullptr in C++11 or later.
-    int ret = SaveEXRImageToFile(&image, &header, outfilename, &err);
-    if (ret != TINYEXR_SUCCESS) {
-        //fprintf(stderr, "Save EXR err: %s\n", err);
-        FreeEXRErrorMessage(err); // free's buffer for an error message
-        return ret;
+    FILE* file = nullptr;
+    fopen_s(&file, outfilename, "wb");
+    if (!file)
+        return false;
+
+    // The offset table is written once the chunks are, and their offsets are known
+    std::vector<uint64_t> offsets(size_t(parts) * chunksPerPart, 0);
+    bool success = fwrite(fileHeader.data(), 1, fileHeader.size(), file) == fileHeader.size();
+    success &= fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+    uint64_t offset = fileHeader.size() + offsets.size() * sizeof(uint64_t);
+    size_t chunkIndex = 0;
+
+    const int blockCount = parts * blocksPerPart;
+    const int batchSize = threadPool ? (threadPool->GetThreadCount() + 1) * 2 : 1;
+    std::vector<std::vector<unsigned char>> batchChunks(batchSize);
+    for (int batchStart = 0; batchStart < blockCount && success; batchStart += batchSize)
+    {
+        const int batchCount = std::min(batchSize, blockCount - batchStart);
+        std::atomic<bool> encoded = true;
+        auto encodeBlock = [&](int index, int threadIndex)
+        {
+            const int block = batchStart + index;
+            const int part = block / blocksPerPart;
+            const int y = (block % blocksPerPart) * c_exrBlockRows;
+            const int rows = std::min(c_exrBlockRows, partHeight - y);
+            const float* partPixels = &pixels[size_t(part) * partHeight * width * srcChannels];
+            int chunkCount = 0;
+            if (!EncodeEXRBlock(batchChunks[index], chunkCount, partPixels, width, y, rows, srcChannels, blockHeader) ||
+                chunkCount != (rows + linesPerChunk - 1) / linesPerChunk)
+                encoded = false;
+        };
+
+        if (threadPool)
+        {
+            threadPool->ParallelFor(batchCount, encodeBlock);
+        }
+        else
+        {
+            for (int index = 0; index < batchCount; ++index)
+                encodeBlock(index, 0);
+        }
+        success &= encoded;
+
+        // Multi-part chunks start with their part number
+        for (int index = 0; index < batchCount && success; ++index)
+        {
+            const int32_t part = (batchStart + index) / blocksPerPart;
+            const std::vector<unsigned char>& chunks = batchChunks[index];
+            size_t pos = 0;
+            while (pos < chunks.size() && success)
+            {
+                int32_t size = 0;
+                memcpy(&size, &chunks[pos + 4], sizeof(size));
+                offsets[chunkIndex++] = offset;
+                if (parts > 1)
+                {
+                    success &= fwrite(&part, sizeof(part), 1, file) == 1;
+                    offset += sizeof(part);
+                }
+                success &= fwrite(&chunks[pos], 1, 8 + size, file) == size_t(8 + size);
+                offset += 8 + size;
+                pos += 8 + size;
+            }
+        }
     }
-    //printf("Saved exr file. [ %s ] \n", outfilename);
 
-    //free(pixels);
+    success &= chunkIndex == offsets.size();
+    success &= fseek(file, (long)fileHeader.size(), SEEK_SET) == 0;
+    success &= fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+    fclose(file);
+    return success;
+}
+
+PNGEncoder::Settings SImage::s_pngSettings;
+SImage::EXRSettings SImage::s_exrSettings;
+bool SImage::s_writeF32Sidecar = false;
+int SImage::s_saveComponents = 0;
 
-    free(header.channels);
-    free(header.pixel_types);
-    free(header.requested_pixel_types);
+static bool SavePNG(const char* fileName, int width, int height, int components, const unsigned char* pixels, ThreadPool* threadPool)
+{
+    PNGEncoder::Settings settings = SImage::s_pngSettings;
+    settings.threadPool = threadPool;
+    return PNGEncoder::Save(fileName, pixels, width, height, components, settings);
+}
 
-    return true;
+// Converts to 8 bit as it encodes, keeping the first SaveComponents() channels
+static bool SavePNG(const char* fileName, int width, int height, int components, const float* pixels, ThreadPool* threadPool)
+{
+    PNGEncoder::Settings settings = SImage::s_pngSettings;
+    settings.threadPool = threadPool;
+    return PNGEncoder::SaveF32(fileName, pixels, width, height, components, SaveComponents(components), settings);
 }
 
 SImage::~SImage()
@@ -206,36 +431,27 @@ bool SImage::Load(ID3D12Device* device, const char* fileName)
     return true;
 }
 
-bool SImage::Save(const char* fileName, PixelConversions pixelConversion)
+bool SImage::Save(const char* fileName, PixelConversions pixelConversion, ThreadPool* threadPool)
 {
+    Trace::Scope scope("save", "io");
+
     switch (pixelConversion)
     {
         case PixelConversions::PixelsAreF32_SaveAsU8:
         {
-            // NOTE: this DOES NOT convert from linear to sRGB
-
-            const size_t count = m_pixels.size() / sizeof(float);
-
-            m_F23ToU8pixels.resize(count);
-
-            const float* src = (const float*)m_pixels.data();
-            unsigned char* dest = m_F23ToU8pixels.data();
-            for (size_t index = 0; index < count; ++index)
-                dest[index] = (unsigned char)std::max(std::min(src[index] * 256.0f, 255.0f), 0.0f);
-
-            return stbi_write_png(fileName, m_width, m_height, m_components, m_F23ToU8pixels.data(), 0) == 1;
+            return SavePNG(fileName, m_width, m_height, m_components, (const float*)m_pixels.data(), threadPool);
         }
         case PixelConversions::PixelsAreU8_SaveAsU8:
         {
-            return stbi_write_png(fileName, m_width, m_height, m_components, m_pixels.data(), 0) == 1;
+            return SavePNG(fileName, m_width, m_height, m_components, m_pixels.data(), threadPool);
         }
         case PixelConversions::PixelsAreF32_SaveAsF32:
         {
             const char* extension = GetFileExtension(fileName);
             if (!_stricmp(extension, ".exr"))
-                return SaveEXR((float*)m_pixels.data(), m_width, m_height, m_components, fileName);
+                return SaveEXR((float*)m_pixels.data(), m_width, m_height, m_components, fileName, threadPool);
             else if (!_stricmp(extension, ".csv"))
-                return SaveCSV((float*)m_pixels.data(), m_width, m_height, m_components, fileName);
+                return SaveCSV((float*)m_pixels.data(), m_width, m_height, m_components, fileName, threadPool);
             else
                 return stbi_write_hdr(fileName, m_width, m_height, m_components, (float*)m_pixels.data()) == 1;
         }
@@ -244,76 +460,59 @@ bool SImage::Save(const char* fileName, PixelConversions pixelConversion)
     return false;
 }
 
-bool SImage::SaveRegion(const char* fileName, int x1, int x2, int y1, int y2, PixelConversions pixelConversion)
+bool SImage::SaveSlices(const std::vector<std::string>& fileNames, int sliceHeight, PixelConversions pixelConversion, ThreadPool& threadPool)
 {
-    int regionSize[2] = {
-        x2 - x1,
-        y2 - y1
-    };
+    Trace::Scope scope("save", "io");
 
-    switch (pixelConversion)
-    {
-        case PixelConversions::PixelsAreF32_SaveAsU8:
-        {
-            // NOTE: this DOES NOT convert from linear to sRGB
-
-            std::vector<unsigned char> outPixels(regionSize[0] * regionSize[1] * m_components);
-            unsigned char* dest = outPixels.data();
+    // Slices span the full width, so each one is a contiguous run of pixels that can be encoded in place.
+    // The slices are what is spread over the threads, so each PNG is deflated as a single strip.
+    const size_t sliceValues = size_t(m_width) * size_t(sliceHeight) * size_t(m_components);
+    std::atomic<bool> success{ true };
 
-            for (int iy = 0; iy < regionSize[1]; ++iy)
+    threadPool.ParallelFor((int)fileNames.size(),
+        [&](int index, int threadIndex)
+        {
+            const char* fileName = fileNames[index].c_str();
+            bool sliceSuccess = false;
+            switch (pixelConversion)
             {
-                const float* src = (const float*)&m_pixels[((iy + y1) * m_width + x1) * m_components * sizeof(float)];
-                for (int ix = 0; ix < regionSize[0] * m_components; ++ix)
+                case PixelConversions::PixelsAreF32_SaveAsU8:
                 {
-                    *dest = (unsigned char)std::max(std::min(*src * 256.0f, 255.0f), 0.0f);
-                    src++;
-                    dest++;
+                    const float* src = &((const float*)m_pixels.data())[index * sliceValues];
+                    sliceSuccess = SavePNG(fileName, m_width, sliceHeight, m_components, src, nullptr);
+                    break;
                 }
-            }
-
-            return stbi_write_png(fileName, regionSize[0], regionSize[1], m_components, outPixels.data(), 0) == 1;
-        }
-        case PixelConversions::PixelsAreU8_SaveAsU8:
-        {
-            std::vector<unsigned char> outPixels(regionSize[0] * regionSize[1] * m_components);
-            unsigned char* dest = outPixels.data();
-
-            for (int iy = 0; iy < regionSize[1]; ++iy)
-            {
-                const unsigned char* src = &m_pixels[((iy + y1) * m_width + x1) * m_components];
-                memcpy(dest, src, regionSize[0] * m_components);
-                dest += regionSize[0] * m_components;
-            }
-
-            return stbi_write_png(fileName, regionSize[0], regionSize[1], m_components, outPixels.data(), 0) == 1;
-        }
-        case PixelConversions::PixelsAreF32_SaveAsF32:
-        {
-            std::vector<float> outPixels(regionSize[0] * regionSize[1] * m_components);
-            float* dest = outPixels.data();
-
-            for (int iy = 0; iy < regionSize[1]; ++iy)
-            {
-                const float* src = (const float*)&m_pixels[((iy + y1) * m_width + x1) * m_components * sizeof(float)];
-                for (int ix = 0; ix < regionSize[0] * m_components; ++ix)
+                case PixelConversions::PixelsAreU8_SaveAsU8:
                 {
-                    *dest = *src;
-                    src++;
-                    dest++;
+                    sliceSuccess = SavePNG(fileName, m_width, sliceHeight, m_components, &m_pixels[index * sliceValues], nullptr);
+                    break;
+                }
+                case PixelConversions::PixelsAreF32_SaveAsF32:
+                {
+                    const float* src = &((const float*)m_pixels.data())[index * sliceValues];
+                    const char* extension = GetFileExtension(fileName);
+                    if (!_stricmp(extension, ".exr"))
+                        sliceSuccess = SaveEXR(src, m_width, sliceHeight, m_components, fileName, nullptr);
+                    else if (!_stricmp(extension, ".csv"))
+                        sliceSuccess = SaveCSV(src, m_width, sliceHeight, m_components, fileName, nullptr);
+                    else
+                        sliceSuccess = stbi_write_hdr(fileName, m_width, sliceHeight, m_components, src) == 1;
+                    break;
                 }
             }
 
-            const char* extension = GetFileExtension(fileName);
-            if (!_stricmp(extension, ".exr"))
-                return SaveEXR(outPixels.data(), regionSize[0], regionSize[1], m_components, fileName);
-            else if(!_stricmp(extension, ".csv"))
-                return SaveCSV(outPixels.data(), regionSize[0], regionSize[1], m_components, fileName);
-            else
-                return stbi_write_hdr(fileName, regionSize[0], regionSize[1], m_components, outPixels.data()) == 1;
+            if (!sliceSuccess)
+                success = false;
         }
-    }
+    );
 
-    return false;
+    return success;
+}
+
+bool SImage::SaveEXRParts(const char* fileName, int sliceHeight, ThreadPool* threadPool)
+{
+    Trace::Scope scope("save", "io");
+    return SaveEXR((const float*)m_pixels.data(), m_width, m_height, m_components, fileName, threadPool, m_height / sliceHeight);
 }
 
 void SImage::UploadPixelsToGPU(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
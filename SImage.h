@@ -6,8 +6,12 @@
 #pragma once
 
 #include "DX12.h"
+#include "PNGEncoder.h"
+#include <string>
 #include <vector>
 
+class ThreadPool;
+
 struct SImage
 {
     ~SImage();
@@ -20,8 +24,14 @@ struct SImage
     };
 
     bool Load(ID3D12Device* device, const char* fileName);
-    bool Save(const char* fileName, PixelConversions pixelConversion);
-    bool SaveRegion(const char* fileName, int x1, int x2, int y1, int y2, PixelConversions pixelConversion);
+    // A thread pool lets a PNG be deflated, or a CSV formatted, in parallel
+    bool Save(const char* fileName, PixelConversions pixelConversion, ThreadPool* threadPool = nullptr);
+
+    // Saves horizontal bands of sliceHeight rows, one file each, converting and encoding them in parallel on the thread pool.
+    bool SaveSlices(const std::vector<std::string>& fileNames, int sliceHeight, PixelConversions pixelConversion, ThreadPool& threadPool);
+
+    // Saves float pixels as a multi-part EXR, with a part for each horizontal band of sliceHeight rows.
+    bool SaveEXRParts(const char* fileName, int sliceHeight, ThreadPool* threadPool = nullptr);
 
     void AdoptResource(ID3D12Resource* resource, int width, int height, int components, DXGI_FORMAT format, int bytesPerComponent)
     {
@@ -40,16 +50,50 @@ struct SImage
         m_resource = resource;
     }
 
+    // Copies only the CPU side of another image, so the copy can be saved while the original is read back into again
+    void CopyCPUData(const SImage& image)
+    {
+        m_width = image.m_width;
+        m_height = image.m_height;
+        m_components = image.m_components;
+        m_format = image.m_format;
+        m_pixels = image.m_pixels;
+    }
+
     void UploadPixelsToGPU(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
     void RequestReadback(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
     void DoReadback();
 
+    // How 8 bit PNGs are written. The thread pool is given per save.
+    static PNGEncoder::Settings s_pngSettings;
+
+    // How many channels of float pixels are saved, the first ones of each pixel. 0 saves them all.
+    // Applies to PNG, EXR and CSV. HDR is always RGB, and a single channel is the same grey either way.
+    static int s_saveComponents;
+
+    // Also write the raw floats of a CSV to a .f32 file next to it
+    static bool s_writeF32Sidecar;
+
+    enum class EXRCompression
+    {
+        None,
+        ZIP,
+        PIZ,
+    };
+
+    // How float EXRs are written. Pixels are always floats in memory, and half is converted to when writing.
+    struct EXRSettings
+    {
+        bool half = false;
+        EXRCompression compression = EXRCompression::None;
+    };
+    static EXRSettings s_exrSettings;
+
     // CPU data
     int m_width = 0;
     int m_height = 0;
     int m_components = 0;
     std::vector<unsigned char> m_pixels;
-    std::vector<unsigned char> m_F23ToU8pixels;
 
     // GPU data
     bool m_releaseResource = true;
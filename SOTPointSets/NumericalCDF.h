@@ -178,3 +178,62 @@ inline CDF CDFFromDensityMap(const DensityMap& densityMap, int numSamples, float
 
 	return ret;
 }
+
+// The CDFs of a density map projected onto angleCount directions evenly spaced around the circle, made once so that the CDF
+// for any direction can be interpolated from the two nearest angles, instead of projecting every pixel again.
+struct RadonTable
+{
+	int angleCount = 0;
+	int numSamples = 0;
+	std::vector<float> CDFs; // angleCount rows of numSamples CDF values. Row i is for the angle 2*pi*i/angleCount.
+};
+
+inline RadonTable RadonTableFromDensityMap(const DensityMap& densityMap, int numSamples, int angleCount)
+{
+	RadonTable ret;
+	ret.angleCount = angleCount;
+	ret.numSamples = numSamples;
+	ret.CDFs.resize(size_t(angleCount) * size_t(numSamples));
+
+	#pragma omp parallel for
+	for (int angleIndex = 0; angleIndex < angleCount; ++angleIndex)
+	{
+		float angle = 2.0f * c_pi * float(angleIndex) / float(angleCount);
+		CDF cdf = CDFFromDensityMap(densityMap, numSamples, float2{ std::cos(angle), std::sin(angle) });
+
+		float* row = &ret.CDFs[size_t(angleIndex) * size_t(numSamples)];
+		for (int i = 0; i < numSamples; ++i)
+			row[i] = cdf.CDFSamples[i].y;
+	}
+
+	return ret;
+}
+
+// Makes the same CDF as CDFFromDensityMap(), by interpolating between the table's two angles on either side of the direction.
+// The x values only depend on the direction, and the y values don't depend on its length. Reuses the storage in ret.
+inline void CDFFromRadonTable(const RadonTable& table, float2 projectionDirection, CDF& ret)
+{
+	float maxX = (std::abs(projectionDirection.x) + std::abs(projectionDirection.y)) * 0.5f;
+	float minX = -maxX;
+
+	// Find the angles on either side, and how far between them the direction is
+	float anglePos = std::atan2(projectionDirection.y, projectionDirection.x) / (2.0f * c_pi) * float(table.angleCount);
+	if (anglePos < 0.0f)
+		anglePos += float(table.angleCount);
+	int angleIndex0 = int(std::floor(anglePos));
+	float angleLerp = anglePos - float(angleIndex0);
+	angleIndex0 = angleIndex0 % table.angleCount;
+	int angleIndex1 = (angleIndex0 + 1) % table.angleCount;
+
+	const float* row0 = &table.CDFs[size_t(angleIndex0) * size_t(table.numSamples)];
+	const float* row1 = &table.CDFs[size_t(angleIndex1) * size_t(table.numSamples)];
+
+	ret.CDFSamples.resize(table.numSamples);
+	for (int i = 0; i < table.numSamples; ++i)
+	{
+		float percent = float(i) / float(table.numSamples - 1);
+		float x = Lerp(minX, maxX, percent);
+		float y = Lerp(row0[i], row1[i], angleLerp);
+		ret.CDFSamples[i] = float2{ x, y };
+	}
+}
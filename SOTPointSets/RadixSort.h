@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+// Maps a float to a uint32 that sorts in the same order, including negative numbers
+inline uint32_t FloatToSortableUint(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	return u ^ ((uint32_t)((int32_t)u >> 31) | 0x80000000u);
+}
+
+// Packs a sort key into the high 32 bits and an index into the low 32 bits
+inline uint64_t MakeSortValue(float key, uint32_t index)
+{
+	return (uint64_t(FloatToSortableUint(key)) << 32) | uint64_t(index);
+}
+
+// LSD radix sort of values made by MakeSortValue(), by their keys. 11 bits per pass, so three passes cover the key, and the
+// index comes along for free. Passes where every value has the same digit are skipped. Stable.
+// scratch is resized to match values, and is only there so it can be reused between calls.
+inline void RadixSort(std::vector<uint64_t>& values, std::vector<uint64_t>& scratch)
+{
+	static const int c_digitBits = 11;
+	static const int c_digitCount = 1 << c_digitBits;
+	static const int c_passCount = 3;
+
+	const size_t count = values.size();
+	if (count < 2)
+		return;
+	scratch.resize(count);
+
+	// Count the digits of all passes in one read
+	uint32_t histograms[c_passCount][c_digitCount] = {};
+	for (uint64_t value : values)
+	{
+		uint32_t key = uint32_t(value >> 32);
+		for (int pass = 0; pass < c_passCount; ++pass)
+			histograms[pass][(key >> (pass * c_digitBits)) & (c_digitCount - 1)]++;
+	}
+
+	for (int pass = 0; pass < c_passCount; ++pass)
+	{
+		uint32_t* histogram = histograms[pass];
+		const int shift = 32 + pass * c_digitBits;
+
+		if (histogram[(values[0] >> shift) & (c_digitCount - 1)] == count)
+			continue;
+
+		// Turn the counts into where each digit starts
+		uint32_t offset = 0;
+		for (int digit = 0; digit < c_digitCount; ++digit)
+		{
+			uint32_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+
+		for (uint64_t value : values)
+			scratch[histogram[(value >> shift) & (c_digitCount - 1)]++] = value;
+
+		values.swap(scratch);
+	}
+}
+
+// Insertion sort of indices by their keys, which is fast when the indices are already nearly in order, as when they are last
+// iteration's order and the keys have barely changed. Gives up, returning false, after moving more than maxMoves indices,
+// leaving the indices in some other order.
+inline bool InsertionSortBounded(std::vector<int>& indices, const std::vector<float>& keys, size_t maxMoves)
+{
+	size_t moves = 0;
+	for (size_t i = 1; i < indices.size(); ++i)
+	{
+		int index = indices[i];
+		float key = keys[index];
+		size_t j = i;
+		while (j > 0 && keys[indices[j - 1]] > key)
+		{
+			indices[j] = indices[j - 1];
+			j--;
+		}
+		indices[j] = index;
+
+		moves += i - j;
+		if (moves > maxMoves)
+			return false;
+	}
+	return true;
+}
@@ -2,6 +2,9 @@
 
 // Settings
 static const float c_imageGaussBlobSigma = 1.5f;
+static const size_t c_warmStartMaxMoves = 8; // -sort warm gives up on last iteration's order after this many moves per point
+static const int c_densityMapCDFSamples = 1000;
+static const size_t c_reduceBlockSize = 2048; // How many floats of the batch directions a thread sums up at a time. Fits in L1.
 
 #include <random>
 #include <vector>
@@ -13,6 +16,7 @@ static const float c_imageGaussBlobSigma = 1.5f;
 
 #include "squarecdf.h"
 #include "NumericalCDF.h"
+#include "RadixSort.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
@@ -22,6 +26,10 @@ static const float c_imageGaussBlobSigma = 1.5f;
 
 #define MULTITHREADED() true
 
+#if MULTITHREADED()
+#include <omp.h>
+#endif
+
 unsigned int g_seed = 0;
 
 // Settings for this execution
@@ -34,12 +42,16 @@ struct Settings
 	unsigned int batchCount = 0;
 	unsigned int batchSize = 0;
 	bool invert = false;
+	std::string sort = "radix";
+	unsigned int radonAngles = 1024;
+	unsigned int threads = 0; // 0 means all of them
+	unsigned int parallelSets = 0; // 0 means as many as fit in the threads
 };
 Settings g_settings;
 
-std::mt19937 GetRNG(int index)
+std::mt19937 GetRNG(unsigned int seed, int index)
 {
-	std::mt19937 ret(g_seed + index);
+	std::mt19937 ret(seed + index);
 	return ret;
 }
 
@@ -117,24 +129,6 @@ void SavePointSet(const std::vector<float2>& points, const char* baseFileName, i
 		fclose(file);
 	}
 
-	// Write out points in binary
-	{
-		char fileName[1024];
-		sprintf_s(fileName, "%s.dat", baseFileName);
-		FILE* file = nullptr;
-		fopen_s(&file, fileName, (setIndex == 0 ? "wb" : "ab"));
-
-		float out[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
-		for (size_t index = 0; index < points.size(); ++index)
-		{
-			out[0] = Clamp(points[index].x * 0.5f + 0.5f, 0.0f, 1.0f);
-			out[1] = Clamp(points[index].y * 0.5f + 0.5f, 0.0f, 1.0f);
-			fwrite(out, sizeof(float), 4, file);
-		}
-
-		fclose(file);
-	}
-
 	// Draw an image of the points
 	{
 		std::vector<unsigned char> pixels(g_settings.outputSize * g_settings.outputSize, 255);
@@ -161,9 +155,31 @@ void SavePointSet(const std::vector<float2>& points, const char* baseFileName, i
 	}
 }
 
-float2 MakeDirection_Gauss(int iterationIndex, int batchIndex, int batchSize)
+// Write out all the point sets in binary, in set order
+void SavePointSetsBinary(const std::vector<std::vector<float2>>& pointSets, const char* baseFileName)
+{
+	char fileName[1024];
+	sprintf_s(fileName, "%s.dat", baseFileName);
+	FILE* file = nullptr;
+	fopen_s(&file, fileName, "wb");
+
+	float out[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	for (const std::vector<float2>& points : pointSets)
+	{
+		for (size_t index = 0; index < points.size(); ++index)
+		{
+			out[0] = Clamp(points[index].x * 0.5f + 0.5f, 0.0f, 1.0f);
+			out[1] = Clamp(points[index].y * 0.5f + 0.5f, 0.0f, 1.0f);
+			fwrite(out, sizeof(float), 4, file);
+		}
+	}
+
+	fclose(file);
+}
+
+float2 MakeDirection_Gauss(unsigned int seed, int iterationIndex, int batchIndex, int batchSize)
 {
-	std::mt19937 rng = GetRNG(iterationIndex * batchSize + batchIndex);
+	std::mt19937 rng = GetRNG(seed, iterationIndex * batchSize + batchIndex);
 	std::normal_distribution<float> distNormal(0.0f, 1.0f);
 
 	// Make a uniform random unit vector by generating 2 normal distributed values and normalizing the result.
@@ -173,9 +189,9 @@ float2 MakeDirection_Gauss(int iterationIndex, int batchIndex, int batchSize)
 	return Normalize(direction);
 }
 
-float2 MakeDirection_GoldenRatio(int iterationIndex, int batchIndex, int batchSize)
+float2 MakeDirection_GoldenRatio(unsigned int seed, int iterationIndex, int batchIndex, int batchSize)
 {
-	std::mt19937 rng = GetRNG(batchIndex);
+	std::mt19937 rng = GetRNG(seed, batchIndex);
 	std::uniform_real_distribution<float> distUniform(0.0f, 1.0f);
 
 	float value01 = distUniform(rng);
@@ -192,12 +208,13 @@ float2 MakeDirection_GoldenRatio(int iterationIndex, int batchIndex, int batchSi
 }
 
 template <typename TMakeDirectionLambda, typename TBatchBeginLambda, typename TBatchEndLambda, typename TICDFLambda>
-void GeneratePoints(int numPoints, int numIterations, int batchSize, const char* baseFileName, bool stratifyLine, int setIndex, const TMakeDirectionLambda& MakeDirectionLambda, const TBatchBeginLambda& BatchBeginLambda, const TBatchEndLambda& BatchEndLambda, const TICDFLambda& ICDFLambda)
+std::vector<float2> GeneratePoints(int numPoints, int numIterations, int batchSize, const char* baseFileName, bool stratifyLine, int setIndex, unsigned int seed, int threadCount, bool showProgress, const TMakeDirectionLambda& MakeDirectionLambda, const TBatchBeginLambda& BatchBeginLambda, const TBatchEndLambda& BatchEndLambda, const TICDFLambda& ICDFLambda)
 {
 	// get the timestamp of when this started
 	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
 
-	printf("%s.%i\n", baseFileName, setIndex);
+	if (showProgress)
+		printf("%s.%i\n", baseFileName, setIndex);
 
 	FILE* file = nullptr;
 	char outputFileNameCSV[1024];
@@ -208,7 +225,7 @@ void GeneratePoints(int numPoints, int numIterations, int batchSize, const char*
 	// Generate the starting points
 	std::vector<float2> points(numPoints);
 	{
-		std::mt19937 rng = GetRNG(0);
+		std::mt19937 rng = GetRNG(seed, 0);
 		std::uniform_real_distribution<float> distUniform(-1.0f, 1.0f);
 		for (float2& p : points)
 		{
@@ -233,6 +250,8 @@ void GeneratePoints(int numPoints, int numIterations, int batchSize, const char*
 		std::vector<int> sorted;
 		std::vector<float> projections;
 		std::vector<float2> batchDirections;
+		std::vector<uint64_t> sortValues;
+		std::vector<uint64_t> sortScratch;
 	};
 	std::vector<BatchData> allBatchData(batchSize, BatchData(numPoints));
 
@@ -242,30 +261,44 @@ void GeneratePoints(int numPoints, int numIterations, int batchSize, const char*
 	{
 		// Do the batches in parallel
 		#if MULTITHREADED()
-		#pragma omp parallel for
+		#pragma omp parallel for num_threads(threadCount)
 		#endif
 		for (int batchIndex = 0; batchIndex < batchSize; ++batchIndex)
 		{
 			BatchData& batchData = allBatchData[batchIndex];
 
-			float2 direction = MakeDirectionLambda(iterationIndex, batchIndex, batchSize);
+			float2 direction = MakeDirectionLambda(seed, iterationIndex, batchIndex, batchSize);
 
 			// project the points
 			for (size_t i = 0; i < numPoints; ++i)
 				batchData.projections[i] = Dot(direction, points[i]);
 
 			// sort the projections
-			std::sort(batchData.sorted.begin(), batchData.sorted.end(),
-				[&](uint32_t a, uint32_t b)
-				{
-					return batchData.projections[a] < batchData.projections[b];
-				}
-			);
+			if (g_settings.sort == "std")
+			{
+				std::sort(batchData.sorted.begin(), batchData.sorted.end(),
+					[&](uint32_t a, uint32_t b)
+					{
+						return batchData.projections[a] < batchData.projections[b];
+					}
+				);
+			}
+			else if (g_settings.sort != "warm" || !InsertionSortBounded(batchData.sorted, batchData.projections, c_warmStartMaxMoves * numPoints))
+			{
+				batchData.sortValues.resize(numPoints);
+				for (size_t i = 0; i < numPoints; ++i)
+					batchData.sortValues[i] = MakeSortValue(batchData.projections[i], uint32_t(i));
+
+				RadixSort(batchData.sortValues, batchData.sortScratch);
+
+				for (size_t i = 0; i < numPoints; ++i)
+					batchData.sorted[i] = int(uint32_t(batchData.sortValues[i]));
+			}
 
 			// update batchDirections
-			std::mt19937 rng = GetRNG(iterationIndex * batchSize + batchIndex);
+			std::mt19937 rng = GetRNG(seed, iterationIndex * batchSize + batchIndex);
 			std::uniform_real_distribution<float> distJitter(0.0f, 1.0f);
-			void* param = BatchBeginLambda(direction);
+			void* param = BatchBeginLambda(direction, batchIndex);
 			for (size_t i = 0; i < numPoints; ++i)
 			{
 				float jitter = 0.5f;
@@ -284,16 +317,36 @@ void GeneratePoints(int numPoints, int numIterations, int batchSize, const char*
 			BatchEndLambda(param);
 		}
 
-		// average all batch directions into batchDirections[0]
+		// average all batch directions into batchDirections[0].
+		// Each thread takes a block of the directions and sums them up in pairs of batches, then pairs of pairs, and so on, with
+		// plain loops over floats that the compiler vectorizes.
 		{
-			for (int batchIndex = 1; batchIndex < batchSize; ++batchIndex)
+			const int floatCount = numPoints * 2;
+			const int blockCount = int((floatCount + c_reduceBlockSize - 1) / c_reduceBlockSize);
+			const float scale = 1.0f / float(batchSize);
+
+			#if MULTITHREADED()
+			#pragma omp parallel for num_threads(threadCount)
+			#endif
+			for (int blockIndex = 0; blockIndex < blockCount; ++blockIndex)
 			{
-				float alpha = 1.0f / float(batchIndex + 1);
-				for (size_t i = 0; i < numPoints; ++i)
+				const int begin = blockIndex * int(c_reduceBlockSize);
+				const int end = std::min(begin + int(c_reduceBlockSize), floatCount);
+
+				for (int stride = 1; stride < batchSize; stride *= 2)
 				{
-					allBatchData[0].batchDirections[i].x = Lerp(allBatchData[0].batchDirections[i].x, allBatchData[batchIndex].batchDirections[i].x, alpha);
-					allBatchData[0].batchDirections[i].y = Lerp(allBatchData[0].batchDirections[i].y, allBatchData[batchIndex].batchDirections[i].y, alpha);
+					for (int batchIndex = 0; batchIndex + stride < batchSize; batchIndex += stride * 2)
+					{
+						float* dest = &allBatchData[batchIndex].batchDirections[0].x;
+						const float* src = &allBatchData[batchIndex + stride].batchDirections[0].x;
+						for (int i = begin; i < end; ++i)
+							dest[i] += src[i];
+					}
 				}
+
+				float* dest = &allBatchData[0].batchDirections[0].x;
+				for (int i = begin; i < end; ++i)
+					dest[i] *= scale;
 			}
 		}
 
@@ -313,11 +366,13 @@ void GeneratePoints(int numPoints, int numIterations, int batchSize, const char*
 		if (percent != lastPercent)
 		{
 			lastPercent = percent;
-			printf("\r[%i%%] %f", percent, totalDistance / float(numPoints));
+			if (showProgress)
+				printf("\r[%i%%] %f", percent, totalDistance / float(numPoints));
 			fprintf(file, "\"%i\",\"%f\"\n", iterationIndex, totalDistance / float(numPoints));
 		}
 	}
-	printf("\n");
+	if (showProgress)
+		printf("\n");
 
 	fclose(file);
 
@@ -326,7 +381,12 @@ void GeneratePoints(int numPoints, int numIterations, int batchSize, const char*
 
 	// report how long this took
 	float elpasedSeconds = std::chrono::duration_cast<std::chrono::duration<float>>(std::chrono::high_resolution_clock::now() - start).count();
-	printf("%0.2f seconds\n\n", elpasedSeconds);
+	if (showProgress)
+		printf("%0.2f seconds\n\n", elpasedSeconds);
+	else
+		printf("%s.%i: %0.2f seconds\n", baseFileName, setIndex, elpasedSeconds);
+
+	return points;
 }
 
 bool GetFromString(std::string& value, const char* s)
@@ -414,6 +474,10 @@ int main(int argc, char** argv)
 			bool advanced = false;
 			advanced |= GetFromCommandLineOptional(argc, argv, argIndex, commandLineOK, g_seed, "-seed");
 			advanced |= GetFromCommandLineNoArgOptional(argc, argv, argIndex, commandLineOK, g_settings.invert, "-invert");
+			advanced |= GetFromCommandLineOptional(argc, argv, argIndex, commandLineOK, g_settings.sort, "-sort");
+			advanced |= GetFromCommandLineOptional(argc, argv, argIndex, commandLineOK, g_settings.radonAngles, "-radonangles");
+			advanced |= GetFromCommandLineOptional(argc, argv, argIndex, commandLineOK, g_settings.threads, "-threads");
+			advanced |= GetFromCommandLineOptional(argc, argv, argIndex, commandLineOK, g_settings.parallelSets, "-parallelsets");
 
 			if (!advanced)
 			{
@@ -422,6 +486,12 @@ int main(int argc, char** argv)
 			}
 		}
 
+		if (commandLineOK && g_settings.sort != "radix" && g_settings.sort != "std" && g_settings.sort != "warm")
+		{
+			printf("[Error] Unknown sort \"%s\"\n", g_settings.sort.c_str());
+			commandLineOK = false;
+		}
+
 		if (!commandLineOK)
 		{
 			printf(
@@ -444,6 +514,13 @@ int main(int argc, char** argv)
 				"\n"
 				"-seed        - Specify the random seed. Useful for making this deterministic.\n"
 				"-invert      - inverts the colors so that light areas get more samples, instead of dark.\n"
+				"-sort        - How to sort the projections: radix (the default), std, or warm. warm starts from\n"
+				"               each batch's order from the last iteration, and radix sorts if that is too far off.\n"
+				"-radonangles - How many angles to project the image onto up front (default 1024). Each batch\n"
+				"               interpolates its CDF from the nearest two. 0 projects the image for every batch.\n"
+				"-threads     - How many threads to use in total (default all of them).\n"
+				"-parallelsets - How many sets to make at once (default as many as there are threads, spread\n"
+				"               evenly). The threads are split between them, for their batches.\n"
 				"\n"
 				"Output Files:\n"
 				"\n"
@@ -456,6 +533,27 @@ int main(int argc, char** argv)
 		}
 	}
 
+	// Split the threads between the sets made at once, and the batches of each set.
+	// Sets don't depend on each other, so they scale better than batches do, which wait for each other every iteration.
+	int threadCount = 1;
+	int parallelSets = 1;
+	#if MULTITHREADED()
+	threadCount = (g_settings.threads > 0) ? int(g_settings.threads) : omp_get_max_threads();
+	if (g_settings.parallelSets > 0)
+	{
+		parallelSets = std::min(int(g_settings.parallelSets), int(g_settings.setCount));
+	}
+	else
+	{
+		int rounds = (int(g_settings.setCount) + threadCount - 1) / threadCount;
+		parallelSets = (int(g_settings.setCount) + rounds - 1) / rounds;
+	}
+	parallelSets = std::max(parallelSets, 1);
+	omp_set_num_threads(threadCount);
+	omp_set_nested(1);
+	#endif
+	int batchThreads = std::max(threadCount / parallelSets, 1);
+
 	// report what we are doing
 	printf(
 		"Loading:     %s\n"
@@ -465,6 +563,9 @@ int main(int argc, char** argv)
 		"batch size:  %u\n"
 		"output size: %u\n"
 		"invert:      %s\n"
+		"sort:        %s\n"
+		"radon angles: %u\n"
+		"threads:     %i (%i sets at once, with %i threads each)\n"
 		"seed:        %u\n"
 		"\n",
 		g_settings.maskFileName.c_str(),
@@ -474,6 +575,9 @@ int main(int argc, char** argv)
 		g_settings.batchSize,
 		g_settings.outputSize,
 		g_settings.invert ? "yes" : "no",
+		g_settings.sort.c_str(),
+		g_settings.radonAngles,
+		threadCount, parallelSets, batchThreads,
 		g_seed
 	);
 
@@ -483,17 +587,46 @@ int main(int argc, char** argv)
 	{
 		DensityMap densityMap = LoadDensityMap(g_settings.maskFileName.c_str(), g_settings.invert);
 
-		std::filesystem::path baseFileNameOut = std::filesystem::path("out") / std::filesystem::path(g_settings.maskFileName).stem();
+		// Project the density map onto all the angles once, for all the sets
+		RadonTable radonTable;
+		if (g_settings.radonAngles > 0)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			radonTable = RadonTableFromDensityMap(densityMap, c_densityMapCDFSamples, int(g_settings.radonAngles));
+			float elpasedSeconds = std::chrono::duration_cast<std::chrono::duration<float>>(std::chrono::high_resolution_clock::now() - start).count();
+			printf("Radon table: %0.2f seconds\n\n", elpasedSeconds);
+		}
+
+		std::string baseFileNameOut = (std::filesystem::path("out") / std::filesystem::path(g_settings.maskFileName).stem()).string();
 
+		// Deterministically make a new seed for each set after the first, so the sets don't depend on how many are made at once
+		std::vector<unsigned int> seeds(g_settings.setCount);
 		for (unsigned int setIndex = 0; setIndex < g_settings.setCount; ++setIndex)
 		{
-			GeneratePoints(g_settings.pointCount, g_settings.batchCount, g_settings.batchSize, baseFileNameOut.string().c_str(), false, setIndex, MakeDirection_Gauss,
+			seeds[setIndex] = g_seed;
+			g_seed = (unsigned int)std::hash<unsigned int>()(g_seed);
+		}
+
+		std::vector<std::vector<float2>> pointSets(g_settings.setCount);
+
+		#if MULTITHREADED()
+		#pragma omp parallel for num_threads(parallelSets) schedule(dynamic)
+		#endif
+		for (int setIndex = 0; setIndex < int(g_settings.setCount); ++setIndex)
+		{
+			// Each batch has it's own CDF, which is reused every iteration
+			std::vector<CDF> batchCDFs(g_settings.batchSize);
+
+			pointSets[setIndex] = GeneratePoints(g_settings.pointCount, g_settings.batchCount, g_settings.batchSize, baseFileNameOut.c_str(), false, setIndex, seeds[setIndex], batchThreads, parallelSets == 1, MakeDirection_Gauss,
 				// Batch Begin
-				[&](const float2& direction)
+				[&](const float2& direction, int batchIndex)
 				{
-					// Make ICDF by projecting density map onto the direction
-					CDF* ret = new CDF;
-					*ret = CDFFromDensityMap(densityMap, 1000, direction);
+					// Make ICDF by projecting density map onto the direction, or interpolating it from the radon table
+					CDF* ret = &batchCDFs[batchIndex];
+					if (g_settings.radonAngles > 0)
+						CDFFromRadonTable(radonTable, direction, *ret);
+					else
+						*ret = CDFFromDensityMap(densityMap, c_densityMapCDFSamples, direction);
 					for (float2& p : ret->CDFSamples)
 						p.y -= 0.5f;
 					return ret;
@@ -501,8 +634,6 @@ int main(int argc, char** argv)
 				// Batch End
 				[](void* param)
 				{
-					CDF* cdf = (CDF*)param;
-					delete cdf;
 				},
 				// ICDF
 				[](void* param, float y, const float2& direction)
@@ -518,10 +649,9 @@ int main(int argc, char** argv)
 					return x * 2.0f;
 				}
 			);
-
-			// Deterministically make a new seed for the next run
-			g_seed = (unsigned int)std::hash<unsigned int>()(g_seed);
 		}
+
+		SavePointSetsBinary(pointSets, baseFileNameOut.c_str());
 	}
 
 	return 0;
@@ -0,0 +1,22 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "fastnoise/public/technique.h"
+
+// How many channels of the texture hold the sample. init.hlsl fills the rest with copies of it, 0 or 1.
+inline int SampleSpaceComponents(fastnoise::SampleSpace sampleSpace)
+{
+    switch (sampleSpace)
+    {
+        case fastnoise::SampleSpace::Real: return 1;
+        case fastnoise::SampleSpace::Circle: return 1;
+        case fastnoise::SampleSpace::Vector2: return 2;
+        case fastnoise::SampleSpace::Vector3: return 3;
+        case fastnoise::SampleSpace::Sphere: return 3;
+        default: return 4;
+    }
+}
@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that run submitted tasks in the order they were submitted
+class ThreadPool
+{
+public:
+    // 0 threads means one per hardware thread
+    ThreadPool(int threadCount = 0)
+    {
+        if (threadCount <= 0)
+            threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+
+        for (int i = 0; i < threadCount; ++i)
+            m_threads.emplace_back([this]() { WorkerThread(); });
+    }
+
+    ~ThreadPool()
+    {
+        Wait();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+        m_taskReady.notify_all();
+        for (std::thread& thread : m_threads)
+            thread.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int GetThreadCount() const
+    {
+        return (int)m_threads.size();
+    }
+
+    void Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+            m_pendingTasks++;
+        }
+        m_taskReady.notify_one();
+    }
+
+    // Blocks until every submitted task has finished
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_tasksDone.wait(lock, [this]() { return m_pendingTasks == 0; });
+    }
+
+    // Calls fn(index, threadIndex) for every index in [0, count), spread over the pool and the calling thread, and returns when all are done.
+    // threadIndex is in [0, GetThreadCount()] and no two calls running at once share one, so it can pick per thread scratch memory.
+    // The calling thread does work too, so this is safe to call from inside a task of the same pool.
+    void ParallelFor(int count, const std::function<void(int index, int threadIndex)>& fn)
+    {
+        struct State
+        {
+            std::atomic<int> nextIndex{ 0 };
+            int doneCount = 0;
+            std::mutex mutex;
+            std::condition_variable allDone;
+        };
+        std::shared_ptr<State> state = std::make_shared<State>();
+
+        auto work = [state, count, &fn](int threadIndex)
+        {
+            int done = 0;
+            int index;
+            while ((index = state->nextIndex++) < count)
+            {
+                fn(index, threadIndex);
+                done++;
+            }
+
+            if (done > 0)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->doneCount += done;
+                if (state->doneCount == count)
+                    state->allDone.notify_all();
+            }
+        };
+
+        // Helpers that start after all the work is taken return without touching fn, so it can live on this stack
+        int helperCount = std::min(count - 1, GetThreadCount());
+        for (int i = 0; i < helperCount; ++i)
+            Submit([work, i]() { work(i + 1); });
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->allDone.wait(lock, [&state, count]() { return state->doneCount == count; });
+    }
+
+private:
+    void WorkerThread()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_taskReady.wait(lock, [this]() { return m_exit || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                    return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+
+            task();
+
+            // Release whatever the task holds before it counts as finished
+            task = nullptr;
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pendingTasks--;
+                if (m_pendingTasks == 0)
+                    m_tasksDone.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    size_t m_pendingTasks = 0;
+    bool m_exit = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_taskReady;
+    std::condition_variable m_tasksDone;
+};
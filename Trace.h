@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Records spans of time from any thread, for -trace, and saves them in Chrome's trace event format, which chrome://tracing
+// and Perfetto open. Nothing is recorded until Start() is called, and until then a Scope only checks a flag.
+// Span names and categories must be string literals, or otherwise outlive the trace, as only the pointers are kept.
+namespace Trace
+{
+    struct Event
+    {
+        const char* name;
+        const char* category;
+        double start;       // Microseconds since Start()
+        double duration;    // Microseconds
+        int thread;
+        int step;           // The optimization step, or -1
+    };
+
+    struct State
+    {
+        std::atomic<bool> enabled{ false };
+        std::chrono::high_resolution_clock::time_point startTime;
+        std::atomic<int> nextThread{ 0 };
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::vector<std::pair<const char*, double>> values;
+    };
+
+    inline State g_state;
+
+    // The row GPU work is drawn on. Chrome draws each thread id as a row.
+    inline constexpr int c_gpuThread = 1000;
+
+    inline bool IsEnabled()
+    {
+        return g_state.enabled.load(std::memory_order_relaxed);
+    }
+
+    inline double Now()
+    {
+        return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(std::chrono::high_resolution_clock::now() - g_state.startTime).count();
+    }
+
+    // Small numbers for the threads, in the order they first record something, so the calling thread of Start() is 0
+    inline int ThreadIndex()
+    {
+        thread_local int index = g_state.nextThread++;
+        return index;
+    }
+
+    inline void Start()
+    {
+        g_state.startTime = std::chrono::high_resolution_clock::now();
+        g_state.events.reserve(64 * 1024);
+        ThreadIndex();
+        g_state.enabled = true;
+    }
+
+    inline void AddSpan(const char* name, const char* category, double start, double duration, int thread, int step = -1)
+    {
+        std::lock_guard<std::mutex> lock(g_state.mutex);
+        g_state.events.push_back({ name, category, start, duration, thread, step });
+    }
+
+    // Numbers saved with the trace, describing the work, such as how many pixels there are
+    inline void SetValue(const char* name, double value)
+    {
+        std::lock_guard<std::mutex> lock(g_state.mutex);
+        g_state.values.push_back({ name, value });
+    }
+
+    // Records the time from construction to destruction on the calling thread
+    class Scope
+    {
+    public:
+        Scope(const char* name, const char* category = "cpu", int step = -1)
+        {
+            if (!IsEnabled())
+                return;
+            m_name = name;
+            m_category = category;
+            m_step = step;
+            m_start = Now();
+        }
+
+        ~Scope()
+        {
+            End();
+        }
+
+        // Ends the span early, for spans that don't match a block
+        void End()
+        {
+            if (m_name)
+                AddSpan(m_name, m_category, m_start, Now() - m_start, ThreadIndex(), m_step);
+            m_name = nullptr;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name = nullptr;
+        const char* m_category = nullptr;
+        int m_step = -1;
+        double m_start = 0.0;
+    };
+
+    inline bool Save(const char* fileName)
+    {
+        std::lock_guard<std::mutex> lock(g_state.mutex);
+
+        FILE* file = nullptr;
+        fopen_s(&file, fileName, "wb");
+        if (!file)
+            return false;
+
+        fprintf(file, "{\"displayTimeUnit\": \"ms\",\n\"otherData\": {");
+        for (size_t index = 0; index < g_state.values.size(); ++index)
+            fprintf(file, "%s\"%s\": %.17g", (index > 0) ? ", " : "", g_state.values[index].first, g_state.values[index].second);
+        fprintf(file, "},\n\"traceEvents\": [\n");
+
+        // Names for the rows
+        int threadCount = g_state.nextThread;
+        for (int thread = 0; thread < threadCount; ++thread)
+        {
+            if (thread == 0)
+                fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"main\"}},\n");
+            else
+                fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %i, \"args\": {\"name\": \"worker %i\"}},\n", thread, thread);
+        }
+        fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %i, \"args\": {\"name\": \"GPU\"}}", c_gpuThread);
+
+        for (const Event& event : g_state.events)
+        {
+            fprintf(file, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %i", event.name, event.category, event.start, event.duration, event.thread);
+            if (event.step >= 0)
+                fprintf(file, ", \"args\": {\"step\": %i}", event.step);
+            fprintf(file, "}");
+        }
+
+        fprintf(file, "\n]}\n");
+        bool success = ferror(file) == 0;
+        fclose(file);
+        return success;
+    }
+
+    // A line per span name: how many there were, and their total, mean and longest time.
+    // Spans on different threads overlap, so the totals can add up to more than the wall time.
+    inline void PrintSummary()
+    {
+        struct Total
+        {
+            const char* category = nullptr;
+            size_t count = 0;
+            double total = 0.0;
+            double longest = 0.0;
+        };
+
+        std::map<std::string, Total> totals;
+        double wallTime = 0.0;
+        {
+            std::lock_guard<std::mutex> lock(g_state.mutex);
+            for (const Event& event : g_state.events)
+            {
+                Total& total = totals[event.name];
+                total.category = event.category;
+                total.count++;
+                total.total += event.duration;
+                total.longest = std::max(total.longest, event.duration);
+                wallTime = std::max(wallTime, event.start + event.duration);
+            }
+        }
+
+        std::vector<std::pair<std::string, Total>> sorted(totals.begin(), totals.end());
+        std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<std::string, Total>& A, const std::pair<std::string, Total>& B)
+            {
+                return A.second.total > B.second.total;
+            }
+        );
+
+        printf("\n%-16s %-5s %10s %12s %10s %10s %8s\n", "span", "cat", "count", "total ms", "mean ms", "max ms", "% wall");
+        for (const std::pair<std::string, Total>& item : sorted)
+        {
+            const Total& total = item.second;
+            printf("%-16s %-5s %10zu %12.3f %10.4f %10.3f %7.1f%%\n", item.first.c_str(), total.category, total.count, total.total / 1000.0,
+                total.total / 1000.0 / double(total.count), total.longest / 1000.0, (wallTime > 0.0) ? 100.0 * total.total / wallTime : 0.0);
+        }
+        printf("wall time %0.3f ms\n", wallTime / 1000.0);
+    }
+}
@@ -0,0 +1,603 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#define NOMINMAX
+#define _CRT_SECURE_NO_WARNINGS
+#include "VolumeTexture.h"
+#include "PixelConversion.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <dxgiformat.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace VolumeTexture
+{
+    struct FormatInfo
+    {
+        const char* name;
+        int channels;
+        int blockSize;      // 1 for uncompressed, 4 for the BC formats
+        int blockBytes;     // Bytes per texel, or per 4x4 block
+        DXGI_FORMAT dxgiFormat;
+        uint32_t vkFormat;
+    };
+
+    static const FormatInfo c_formatInfos[] =
+    {
+        { "r8", 1, 1, 1, DXGI_FORMAT_R8_UNORM, 9 },                     // VK_FORMAT_R8_UNORM
+        { "rg8", 2, 1, 2, DXGI_FORMAT_R8G8_UNORM, 16 },                 // VK_FORMAT_R8G8_UNORM
+        { "rgba8", 4, 1, 4, DXGI_FORMAT_R8G8B8A8_UNORM, 37 },           // VK_FORMAT_R8G8B8A8_UNORM
+        { "r16f", 1, 1, 2, DXGI_FORMAT_R16_FLOAT, 76 },                 // VK_FORMAT_R16_SFLOAT
+        { "rgba16f", 4, 1, 8, DXGI_FORMAT_R16G16B16A16_FLOAT, 97 },     // VK_FORMAT_R16G16B16A16_SFLOAT
+        { "bc4", 1, 4, 8, DXGI_FORMAT_BC4_UNORM, 139 },                 // VK_FORMAT_BC4_UNORM_BLOCK
+        { "bc5", 2, 4, 16, DXGI_FORMAT_BC5_UNORM, 141 },                // VK_FORMAT_BC5_UNORM_BLOCK
+        { "bc7", 4, 4, 16, DXGI_FORMAT_BC7_UNORM, 145 },                // VK_FORMAT_BC7_UNORM_BLOCK
+    };
+
+    uint16_t ToF16(float value)
+    {
+        uint32_t f;
+        memcpy(&f, &value, sizeof(f));
+
+        uint32_t sign = (f >> 16) & 0x8000;
+        uint32_t absF = f & 0x7FFFFFFF;
+
+        // NaN and infinity
+        if (absF >= 0x7F800000)
+            return (uint16_t)(sign | 0x7C00 | ((absF > 0x7F800000) ? 0x200 : 0));
+
+        // Too big for a half
+        if (absF >= 0x477FF000)
+            return (uint16_t)(sign | 0x7C00);
+
+        // Denormal halves, and zero. Anything below 2^-25 rounds to zero, which also keeps the shifts below 32.
+        if (absF < 0x38800000)
+        {
+            int shift = 113 - (int)(absF >> 23);
+            if (shift > 11)
+                return (uint16_t)sign;
+            uint32_t mantissa = (absF & 0x007FFFFF) | 0x00800000;
+            uint32_t half = mantissa >> (shift + 13);
+            uint32_t rest = mantissa & ((1u << (shift + 13)) - 1);
+            uint32_t halfway = 1u << (shift + 12);
+            if (rest > halfway || (rest == halfway && (half & 1)))
+                half++;
+            return (uint16_t)(sign | half);
+        }
+
+        // Normal halves. Rounding can carry into the exponent, which is still correct.
+        uint32_t half = (absF - 0x38000000) >> 13;
+        uint32_t rest = absF & 0x1FFF;
+        if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+
+    // Packs bits into a 128 bit block, low bits first
+    struct BitWriter
+    {
+        unsigned char* block;
+        int bit = 0;
+
+        void Write(uint32_t value, int bitCount)
+        {
+            for (int i = 0; i < bitCount; ++i, ++bit)
+            {
+                if (value & (1u << i))
+                    block[bit / 8] |= (unsigned char)(1u << (bit % 8));
+            }
+        }
+    };
+
+    // One channel of a 4x4 block, as 8 bits from the min and max with 6 interpolated values between
+    static void EncodeBC4Block(unsigned char* block, const unsigned char values[16])
+    {
+        int minValue = 255;
+        int maxValue = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            minValue = std::min(minValue, (int)values[i]);
+            maxValue = std::max(maxValue, (int)values[i]);
+        }
+
+        memset(block, 0, 8);
+        block[0] = (unsigned char)maxValue;
+        block[1] = (unsigned char)minValue;
+
+        // With equal endpoints every index decodes to the same value
+        if (maxValue == minValue)
+            return;
+
+        // Palette order is max, min, then 6 steps from max to min
+        static const int c_paletteIndex[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+        uint64_t indices = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int step = ((values[i] - minValue) * 14 + (maxValue - minValue)) / (2 * (maxValue - minValue));
+            indices |= uint64_t(c_paletteIndex[step]) << (3 * i);
+        }
+        for (int i = 0; i < 6; ++i)
+            block[2 + i] = (unsigned char)(indices >> (8 * i));
+    }
+
+    // BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a shared low bit each, and 4 bit indices.
+    // Encodes the block with endpoints as close as possible to the targets given, and returns the squared error.
+    static int EncodeBC7Mode6(unsigned char* block, const unsigned char texels[16][4], const int target0[4], const int target1[4])
+    {
+        static const int c_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        // Choose the endpoint low bits that get closest to the targets, then quantize to 7 bits
+        int endpoints[2][4];
+        int pbits[2];
+        {
+            const int* targets[2] = { target0, target1 };
+            for (int e = 0; e < 2; ++e)
+            {
+                int bestError = -1;
+                for (int p = 0; p < 2; ++p)
+                {
+                    int error = 0;
+                    int quantized[4];
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        quantized[c] = std::min(std::max((targets[e][c] - p + 1) >> 1, 0), 127);
+                        int decoded = (quantized[c] << 1) | p;
+                        error += (decoded - targets[e][c]) * (decoded - targets[e][c]);
+                    }
+                    if (bestError < 0 || error < bestError)
+                    {
+                        bestError = error;
+                        pbits[e] = p;
+                        memcpy(endpoints[e], quantized, sizeof(quantized));
+                    }
+                }
+            }
+        }
+
+        // The 16 colors the indices can pick from
+        int palette[16][4];
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                int e0 = (endpoints[0][c] << 1) | pbits[0];
+                int e1 = (endpoints[1][c] << 1) | pbits[1];
+                palette[i][c] = ((64 - c_weights[i]) * e0 + c_weights[i] * e1 + 32) >> 6;
+            }
+        }
+
+        int indices[16];
+        int totalError = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestError = -1;
+            for (int j = 0; j < 16; ++j)
+            {
+                int error = 0;
+                for (int c = 0; c < 4; ++c)
+                    error += (palette[j][c] - texels[i][c]) * (palette[j][c] - texels[i][c]);
+                if (bestError < 0 || error < bestError)
+                {
+                    bestError = error;
+                    indices[i] = j;
+                }
+            }
+            totalError += bestError;
+        }
+
+        // The first index is stored without its top bit, so it must be below 8. Swapping the endpoints mirrors the indices to make it so.
+        if (indices[0] >= 8)
+        {
+            for (int c = 0; c < 4; ++c)
+                std::swap(endpoints[0][c], endpoints[1][c]);
+            std::swap(pbits[0], pbits[1]);
+            for (int i = 0; i < 16; ++i)
+                indices[i] = 15 - indices[i];
+        }
+
+        memset(block, 0, 16);
+        BitWriter writer{ block };
+        writer.Write(1 << 6, 7);
+        for (int c = 0; c < 4; ++c)
+        {
+            writer.Write(endpoints[0][c], 7);
+            writer.Write(endpoints[1][c], 7);
+        }
+        writer.Write(pbits[0], 1);
+        writer.Write(pbits[1], 1);
+        for (int i = 0; i < 16; ++i)
+            writer.Write(indices[i], (i == 0) ? 3 : 4);
+
+        return totalError;
+    }
+
+    static void EncodeBC7Block(unsigned char* block, const unsigned char texels[16][4])
+    {
+        // Endpoints are opposite corners of the bounding box of the block
+        int lo[4] = { 255, 255, 255, 255 };
+        int hi[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                lo[c] = std::min(lo[c], (int)texels[i][c]);
+                hi[c] = std::max(hi[c], (int)texels[i][c]);
+            }
+        }
+
+        // Try each of the 8 diagonals of the box and keep the one with the least error
+        int bestError = -1;
+        for (int diagonal = 0; diagonal < 8; ++diagonal)
+        {
+            int target0[4] = { lo[0], lo[1], lo[2], lo[3] };
+            int target1[4] = { hi[0], hi[1], hi[2], hi[3] };
+            for (int c = 1; c < 4; ++c)
+            {
+                if (diagonal & (1 << (c - 1)))
+                    std::swap(target0[c], target1[c]);
+            }
+
+            unsigned char candidate[16];
+            int error = EncodeBC7Mode6(candidate, texels, target0, target1);
+            if (bestError < 0 || error < bestError)
+            {
+                bestError = error;
+                memcpy(block, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    // Converts and encodes slice z into dest
+    static void EncodeSlice(unsigned char* dest, const float* pixels, int width, int height, int z, const FormatInfo& info)
+    {
+        const float* slice = &pixels[size_t(z) * width * height * 4];
+
+        if (info.dxgiFormat == DXGI_FORMAT_R16_FLOAT || info.dxgiFormat == DXGI_FORMAT_R16G16B16A16_FLOAT)
+        {
+            for (size_t i = 0; i < size_t(width) * height; ++i)
+            {
+                const float* src = &slice[i * 4];
+                for (int c = 0; c < info.channels; ++c)
+                {
+                    uint16_t half = ToF16(src[c]);
+                    memcpy(dest, &half, sizeof(half));
+                    dest += sizeof(half);
+                }
+            }
+            return;
+        }
+
+        // The same conversion as PNG output
+        if (info.blockSize == 1)
+        {
+            PixelConversion::F32ToU8(dest, slice, size_t(width) * height, 4, info.channels);
+            return;
+        }
+
+        // Blocks hanging off the edge repeat the last row and column
+        for (int by = 0; by < height; by += 4)
+        {
+            for (int bx = 0; bx < width; bx += 4)
+            {
+                unsigned char texels[16][4];
+                for (int i = 0; i < 16; ++i)
+                {
+                    int x = std::min(bx + (i % 4), width - 1);
+                    int y = std::min(by + (i / 4), height - 1);
+                    PixelConversion::F32ToU8(texels[i], &slice[(size_t(y) * width + x) * 4], 1, 4, 4);
+                }
+
+                switch (info.dxgiFormat)
+                {
+                    case DXGI_FORMAT_BC4_UNORM:
+                    case DXGI_FORMAT_BC5_UNORM:
+                    {
+                        for (int c = 0; c < info.channels; ++c)
+                        {
+                            unsigned char values[16];
+                            for (int i = 0; i < 16; ++i)
+                                values[i] = texels[i][c];
+                            EncodeBC4Block(dest + c * 8, values);
+                        }
+                        break;
+                    }
+                    case DXGI_FORMAT_BC7_UNORM:
+                    {
+                        EncodeBC7Block(dest, texels);
+                        break;
+                    }
+                    default:
+                        break;
+                }
+                dest += info.blockBytes;
+            }
+        }
+    }
+
+    static size_t GetSliceBytes(int width, int height, const FormatInfo& info)
+    {
+        size_t blocksX = (width + info.blockSize - 1) / info.blockSize;
+        size_t blocksY = (height + info.blockSize - 1) / info.blockSize;
+        return blocksX * blocksY * info.blockBytes;
+    }
+
+    static void AppendU32(std::vector<unsigned char>& out, uint32_t value)
+    {
+        out.insert(out.end(), (unsigned char*)&value, (unsigned char*)&value + sizeof(value));
+    }
+
+    static void AppendU64(std::vector<unsigned char>& out, uint64_t value)
+    {
+        out.insert(out.end(), (unsigned char*)&value, (unsigned char*)&value + sizeof(value));
+    }
+
+    static void WriteDDSHeader(std::vector<unsigned char>& out, int width, int height, int depth, const FormatInfo& info)
+    {
+        static const uint32_t DDSD_CAPS = 0x1;
+        static const uint32_t DDSD_HEIGHT = 0x2;
+        static const uint32_t DDSD_WIDTH = 0x4;
+        static const uint32_t DDSD_PITCH = 0x8;
+        static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+        static const uint32_t DDSD_LINEARSIZE = 0x80000;
+        static const uint32_t DDSD_DEPTH = 0x800000;
+        static const uint32_t DDPF_FOURCC = 0x4;
+        static const uint32_t DDSCAPS_COMPLEX = 0x8;
+        static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+        static const uint32_t DDSCAPS2_VOLUME = 0x200000;
+        static const uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE3D = 4;
+
+        bool compressed = info.blockSize > 1;
+
+        out.insert(out.end(), { 'D', 'D', 'S', ' ' });
+
+        // DDS_HEADER
+        AppendU32(out, 124);
+        AppendU32(out, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_DEPTH | (compressed ? DDSD_LINEARSIZE : DDSD_PITCH));
+        AppendU32(out, height);
+        AppendU32(out, width);
+        AppendU32(out, compressed ? (uint32_t)GetSliceBytes(width, height, info) : uint32_t(width * info.blockBytes));
+        AppendU32(out, depth);
+        AppendU32(out, 1);  // mip count
+        for (int i = 0; i < 11; ++i)
+            AppendU32(out, 0);
+
+        // DDS_PIXELFORMAT, pointing to the DX10 header for the real format
+        AppendU32(out, 32);
+        AppendU32(out, DDPF_FOURCC);
+        out.insert(out.end(), { 'D', 'X', '1', '0' });
+        for (int i = 0; i < 5; ++i)
+            AppendU32(out, 0);
+
+        AppendU32(out, DDSCAPS_COMPLEX | DDSCAPS_TEXTURE);
+        AppendU32(out, DDSCAPS2_VOLUME);
+        AppendU32(out, 0);
+        AppendU32(out, 0);
+        AppendU32(out, 0);
+
+        // DDS_HEADER_DXT10
+        AppendU32(out, info.dxgiFormat);
+        AppendU32(out, D3D10_RESOURCE_DIMENSION_TEXTURE3D);
+        AppendU32(out, 0);  // misc flags
+        AppendU32(out, 1);  // array size
+        AppendU32(out, 0);  // misc flags 2
+    }
+
+    // The basic data format descriptor that KTX2 requires, as in the Khronos Data Format Specification
+    static std::vector<unsigned char> MakeKTX2DFD(const FormatInfo& info)
+    {
+        static const unsigned char KHR_DF_MODEL_RGBSDA = 1;
+        static const unsigned char KHR_DF_MODEL_BC4 = 131;
+        static const unsigned char KHR_DF_MODEL_BC5 = 132;
+        static const unsigned char KHR_DF_MODEL_BC7 = 134;
+        static const unsigned char KHR_DF_PRIMARIES_BT709 = 1;
+        static const unsigned char KHR_DF_TRANSFER_LINEAR = 1;
+        static const unsigned char KHR_DF_SAMPLE_DATATYPE_FLOAT = 0x80;
+        static const unsigned char KHR_DF_SAMPLE_DATATYPE_SIGNED = 0x40;
+        static const unsigned char c_channelIds[4] = { 0, 1, 2, 15 }; // R, G, B, A
+
+        struct Sample
+        {
+            uint16_t bitOffset;
+            unsigned char bitLength;
+            unsigned char channelType;
+            uint32_t lower;
+            uint32_t upper;
+        };
+        std::vector<Sample> samples;
+
+        unsigned char colorModel = KHR_DF_MODEL_RGBSDA;
+        switch (info.dxgiFormat)
+        {
+            case DXGI_FORMAT_BC4_UNORM:
+                colorModel = KHR_DF_MODEL_BC4;
+                samples.push_back({ 0, 63, 0, 0, 0xFFFFFFFF });
+                break;
+            case DXGI_FORMAT_BC5_UNORM:
+                colorModel = KHR_DF_MODEL_BC5;
+                samples.push_back({ 0, 63, 0, 0, 0xFFFFFFFF });
+                samples.push_back({ 64, 63, 1, 0, 0xFFFFFFFF });
+                break;
+            case DXGI_FORMAT_BC7_UNORM:
+                colorModel = KHR_DF_MODEL_BC7;
+                samples.push_back({ 0, 127, 0, 0, 0xFFFFFFFF });
+                break;
+            default:
+            {
+                bool isFloat = info.dxgiFormat == DXGI_FORMAT_R16_FLOAT || info.dxgiFormat == DXGI_FORMAT_R16G16B16A16_FLOAT;
+                int bits = isFloat ? 16 : 8;
+                for (int c = 0; c < info.channels; ++c)
+                {
+                    if (isFloat)
+                        samples.push_back({ (uint16_t)(c * bits), (unsigned char)(bits - 1), (unsigned char)(c_channelIds[c] | KHR_DF_SAMPLE_DATATYPE_FLOAT | KHR_DF_SAMPLE_DATATYPE_SIGNED), 0xBF800000, 0x3F800000 });
+                    else
+                        samples.push_back({ (uint16_t)(c * bits), (unsigned char)(bits - 1), c_channelIds[c], 0, 255 });
+                }
+                break;
+            }
+        }
+
+        uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+
+        std::vector<unsigned char> dfd;
+        AppendU32(dfd, 4 + blockSize);
+        AppendU32(dfd, 0);                      // vendor: Khronos, descriptor type: basic
+        AppendU32(dfd, 2 | (blockSize << 16));  // version 1.3, block size
+        dfd.push_back(colorModel);
+        dfd.push_back(KHR_DF_PRIMARIES_BT709);
+        dfd.push_back(KHR_DF_TRANSFER_LINEAR);
+        dfd.push_back(0);                       // flags: straight alpha
+        dfd.push_back((unsigned char)(info.blockSize - 1));
+        dfd.push_back((unsigned char)(info.blockSize - 1));
+        dfd.push_back(0);
+        dfd.push_back(0);
+        dfd.push_back((unsigned char)info.blockBytes);
+        for (int i = 0; i < 7; ++i)
+            dfd.push_back(0);
+
+        for (const Sample& sample : samples)
+        {
+            dfd.push_back((unsigned char)(sample.bitOffset & 0xFF));
+            dfd.push_back((unsigned char)(sample.bitOffset >> 8));
+            dfd.push_back(sample.bitLength);
+            dfd.push_back(sample.channelType);
+            AppendU32(dfd, 0);                  // sample position
+            AppendU32(dfd, sample.lower);
+            AppendU32(dfd, sample.upper);
+        }
+
+        return dfd;
+    }
+
+    static void WriteKTX2Header(std::vector<unsigned char>& out, int width, int height, int depth, const FormatInfo& info, size_t dataBytes)
+    {
+        static const unsigned char c_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+        static const uint32_t c_headerBytes = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+        static const uint32_t c_levelIndexBytes = 3 * 8;
+
+        std::vector<unsigned char> dfd = MakeKTX2DFD(info);
+        uint32_t dfdOffset = c_headerBytes + c_levelIndexBytes;
+
+        // Level data is aligned to a multiple of both 4 and the block size, which 16 is for every format here
+        uint64_t dataOffset = (dfdOffset + dfd.size() + 15) & ~uint64_t(15);
+
+        out.insert(out.end(), c_identifier, c_identifier + sizeof(c_identifier));
+        AppendU32(out, info.vkFormat);
+        AppendU32(out, (info.blockSize > 1) ? 1 : ((info.blockBytes / info.channels == 2) ? 2 : 1));   // type size
+        AppendU32(out, width);
+        AppendU32(out, height);
+        AppendU32(out, depth);
+        AppendU32(out, 0);  // layer count
+        AppendU32(out, 1);  // face count
+        AppendU32(out, 1);  // level count
+        AppendU32(out, 0);  // supercompression scheme
+
+        AppendU32(out, dfdOffset);
+        AppendU32(out, (uint32_t)dfd.size());
+        AppendU32(out, 0);  // key/value data
+        AppendU32(out, 0);
+        AppendU64(out, 0);  // supercompression global data
+        AppendU64(out, 0);
+
+        AppendU64(out, dataOffset);
+        AppendU64(out, dataBytes);
+        AppendU64(out, dataBytes);
+
+        out.insert(out.end(), dfd.begin(), dfd.end());
+        out.resize((size_t)dataOffset, 0);
+    }
+
+    bool ContainerFromString(const char* name, Container& container)
+    {
+        if (!_stricmp(name, "dds"))
+            container = Container::DDS;
+        else if (!_stricmp(name, "ktx2"))
+            container = Container::KTX2;
+        else
+            return false;
+        return true;
+    }
+
+    bool FormatFromString(const char* name, Format& format)
+    {
+        for (int i = 0; i < (int)_countof(c_formatInfos); ++i)
+        {
+            if (!_stricmp(name, c_formatInfos[i].name))
+            {
+                format = (Format)i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Encode(std::vector<unsigned char>& data, const float* pixels, int width, int height, int depth, Format format, ThreadPool* threadPool)
+    {
+        if (width <= 0 || height <= 0 || depth <= 0)
+            return false;
+
+        const FormatInfo& info = c_formatInfos[(int)format];
+
+        const size_t sliceBytes = GetSliceBytes(width, height, info);
+        data.resize(sliceBytes * depth);
+
+        auto encodeSlice = [&](int z, int threadIndex)
+        {
+            EncodeSlice(&data[sliceBytes * z], pixels, width, height, z, info);
+        };
+
+        if (threadPool)
+        {
+            threadPool->ParallelFor(depth, encodeSlice);
+        }
+        else
+        {
+            for (int z = 0; z < depth; ++z)
+                encodeSlice(z, 0);
+        }
+
+        return true;
+    }
+
+    uint32_t GetDXGIFormat(Format format)
+    {
+        return c_formatInfos[(int)format].dxgiFormat;
+    }
+
+    void GetPitches(Format format, int width, int height, size_t& rowPitch, size_t& slicePitch)
+    {
+        const FormatInfo& info = c_formatInfos[(int)format];
+        rowPitch = size_t((width + info.blockSize - 1) / info.blockSize) * info.blockBytes;
+        slicePitch = GetSliceBytes(width, height, info);
+    }
+
+    bool Save(const char* fileName, const float* pixels, int width, int height, int depth, Container container, Format format, ThreadPool* threadPool)
+    {
+        Trace::Scope scope("save", "io");
+
+        std::vector<unsigned char> data;
+        if (!Encode(data, pixels, width, height, depth, format, threadPool))
+            return false;
+
+        const FormatInfo& info = c_formatInfos[(int)format];
+        std::vector<unsigned char> header;
+        if (container == Container::DDS)
+            WriteDDSHeader(header, width, height, depth, info);
+        else
+            WriteKTX2Header(header, width, height, depth, info, data.size());
+
+        FILE* file = nullptr;
+        fopen_s(&file, fileName, "wb");
+        if (!file)
+            return false;
+
+        bool success = fwrite(header.data(), 1, header.size(), file) == header.size() &&
+            fwrite(data.data(), 1, data.size(), file) == data.size();
+        fclose(file);
+        return success;
+    }
+}
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class ThreadPool;
+
+// Writes a FastNoise texture as a 3D volume texture, instead of the tall 2D atlas of slices. The source is
+// RGBA float pixels, width x (height * depth), and the format keeps as many channels as it has.
+// Block compressed formats are encoded on the CPU with a slice per thread. BC7 only uses mode 6, which
+// suits noise: there are no shapes or gradients within a block for the partitioned modes to exploit.
+namespace VolumeTexture
+{
+    enum class Container
+    {
+        DDS,
+        KTX2,
+    };
+
+    enum class Format
+    {
+        R8,
+        RG8,
+        RGBA8,
+        R16F,
+        RGBA16F,
+        BC4,    // R, 4 bits per texel
+        BC5,    // RG, 8 bits per texel
+        BC7,    // RGBA, 8 bits per texel
+    };
+
+    bool ContainerFromString(const char* name, Container& container);
+    bool FormatFromString(const char* name, Format& format);
+
+    // The DXGI_FORMAT of a format, and the bytes per row (a row of blocks for BC formats) and per slice that Encode() writes
+    uint32_t GetDXGIFormat(Format format);
+    void GetPitches(Format format, int width, int height, size_t& rowPitch, size_t& slicePitch);
+
+    // Float to half, rounding to nearest even, with overflow to infinity and gradual underflow. tools/f16check compares
+    // it against a reference for every float.
+    uint16_t ToF16(float value);
+
+    // Converts and encodes the texel data of every slice, in the order both containers store it
+    bool Encode(std::vector<unsigned char>& data, const float* pixels, int width, int height, int depth, Format format, ThreadPool* threadPool);
+
+    bool Save(const char* fileName, const float* pixels, int width, int height, int depth, Container container, Format format, ThreadPool* threadPool);
+}
@@ -16,10 +16,13 @@ float inv_error_function(float x)
 /*$(_compute:Init)*/(uint3 DTid : SV_DispatchThreadID)
 {
 
-	// Set swap count to zero
+	// Set swap statistics to zero
 	if (all(DTid == 0))
 	{
 		Data[0].swaps = 0;
+		Data[0].candidates = 0;
+		Data[0].acceptedLoss = 0;
+		Data[0].uphillSwaps = 0;
 	}
 
 	// Beyond this point only do first-run initialization
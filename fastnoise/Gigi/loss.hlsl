@@ -74,7 +74,85 @@ float doubledFilter(int3 i, int3 filterMin, int3 filterMax, int3 filterOffset)
 	return combineFilter(i, filter.x, filter.y, filter.z);
 }
 
-/*$(_compute:Loss)*/(uint3 DTid : SV_DispatchThreadID)
+// Small spatial footprints (e.g. Box 3, Binomial 2) are read from a tile of the slice that the thread group
+// loads into groupshared memory once, instead of every pixel fetching its whole footprint from the texture.
+#define WINDOW_MAX_FOOTPRINT 7
+#define WINDOW_TILE_SIZE (8 + WINDOW_MAX_FOOTPRINT - 1)
+groupshared float4 g_window[WINDOW_TILE_SIZE][WINDOW_TILE_SIZE];
+
+// The tile only holds one slice, so it can be used when the XY footprint fits and every tap that has a
+// non zero weight away from the centre column is on that slice.
+bool useWindowedLoss(int3 filterMin, int3 filterMax)
+{
+	if (any(filterMax.xy - filterMin.xy >= WINDOW_MAX_FOOTPRINT))
+		return false;
+
+	if (/*$(Variable:separate)*/)
+		return filterMin.z <= 0 && filterMax.z >= 0;
+
+	return filterMin.z == filterMax.z;
+}
+
+// Same taps in the same order as the generic loop in Loss() so the results are identical. Taps the generic loop
+// visits with a zero weight (off the centre column and off slice 0 when separate) are skipped.
+float windowedLoss(int3 index, uint3 groupThreadID, float4 currentValue, float4 otherValue, uint3 textureSize, int3 filterMin, int3 filterMax, int3 filterOffset)
+{
+	bool separate = /*$(Variable:separate)*/;
+	int windowZ = separate ? 0 : filterMin.z;
+
+	// Cooperatively load the tile covering the group plus the filter apron
+	int2 threadPos = int2(groupThreadID.xy);
+	int2 tileOrigin = index.xy - threadPos + filterMin.xy;
+	int2 tileSize = filterMax.xy - filterMin.xy + 8;
+	for (int t = threadPos.y * 8 + threadPos.x; t < tileSize.x * tileSize.y; t += 64)
+	{
+		int2 tilePos = int2(t % tileSize.x, t / tileSize.x);
+		g_window[tilePos.y][tilePos.x] = SampleTexture[uint3(int3(tileOrigin + tilePos, index.z + windowZ)) % textureSize];
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	float deltaLoss = 0.0f;
+
+	for (int i = filterMin.x; i <= filterMax.x; ++i)
+	{
+		float filterX = Filter[i + filterOffset.x];
+
+		for (int j = filterMin.y; j <= filterMax.y; ++j)
+		{
+			float filterY = Filter[j + filterOffset.y];
+
+			float4 windowValue = g_window[threadPos.y + j - filterMin.y][threadPos.x + i - filterMin.x];
+
+			if (separate && i == 0 && j == 0)
+			{
+				// The centre column carries the Z filter, which can extend past the tile
+				for (int k = filterMin.z; k <= filterMax.z; ++k)
+				{
+					float filterZ = Filter[k + filterOffset.z];
+
+					float F = combineFilter(int3(i, j, k), filterX, filterY, filterZ);
+
+					float4 neighbourValue = windowValue;
+					if (k != 0)
+						neighbourValue = SampleTexture[uint3(index + int3(i, j, k)) % textureSize];
+					deltaLoss += F * (K2(otherValue, neighbourValue) - K2(currentValue, neighbourValue));
+				}
+			}
+			else
+			{
+				float filterZ = Filter[windowZ + filterOffset.z];
+
+				float F = combineFilter(int3(i, j, windowZ), filterX, filterY, filterZ);
+
+				deltaLoss += F * (K2(otherValue, windowValue) - K2(currentValue, windowValue));
+			}
+		}
+	}
+
+	return deltaLoss;
+}
+
+/*$(_compute:Loss)*/(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
 {
 	int3 index = DTid;
 	float4 currentValue = SampleTexture[index];
@@ -90,23 +168,31 @@ float doubledFilter(int3 i, int3 filterMin, int3 filterMax, int3 filterOffset)
 
 	float deltaLoss = 0.0f;
 
-	for (int i = filterMin.x; i <= filterMax.x; ++i)
+	// Uniform across the dispatch, so the group sync in windowedLoss() is safe
+	if (useWindowedLoss(filterMin, filterMax))
 	{
-		float filterX = Filter[i + filterOffset.x];
-
-		for (int j = filterMin.y; j <= filterMax.y; ++j)
+		deltaLoss = windowedLoss(index, GTid, currentValue, otherValue, textureSize, filterMin, filterMax, filterOffset);
+	}
+	else
+	{
+		for (int i = filterMin.x; i <= filterMax.x; ++i)
 		{
-			float filterY = Filter[j + filterOffset.y];
+			float filterX = Filter[i + filterOffset.x];
+
+			for (int j = filterMin.y; j <= filterMax.y; ++j)
+			{
+				float filterY = Filter[j + filterOffset.y];
 
-			for (int k = filterMin.z; k <= filterMax.z; ++k) {
+				for (int k = filterMin.z; k <= filterMax.z; ++k) {
 
-				float filterZ = Filter[k + filterOffset.z];
+					float filterZ = Filter[k + filterOffset.z];
 
-				float F = combineFilter(int3(i, j, k), filterX, filterY, filterZ);
+					float F = combineFilter(int3(i, j, k), filterX, filterY, filterZ);
 
-				float4 neighbourValue = SampleTexture[uint3(index + int3(i, j, k)) % textureSize];
-				deltaLoss += F * (K2(otherValue, neighbourValue) - K2(currentValue, neighbourValue));
+					float4 neighbourValue = SampleTexture[uint3(index + int3(i, j, k)) % textureSize];
+					deltaLoss += F * (K2(otherValue, neighbourValue) - K2(currentValue, neighbourValue));
 
+				}
 			}
 		}
 	}
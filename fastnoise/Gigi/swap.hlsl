@@ -2,7 +2,11 @@
 
 #include "fastnoise.hlsl"
 
-/*$(_compute:Swap)*/(uint3 DTid : SV_DispatchThreadID)
+// Per group swap statistics, reduced in groupshared memory so that only one thread per group touches the Data buffer
+groupshared uint3 g_swapCounts[64];
+groupshared float g_swapLoss[64];
+
+/*$(_compute:Swap)*/(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
 {
 	// 1. Total loss for the swap is sum of loss texture at source and destination
 	uint3 index = DTid;
@@ -25,16 +29,54 @@
 	uint swapSuppression = /*$(Variable:swapSuppression)*/;
 	bool swapCheck = (randomValue % swapSuppression) == 0;
 
-	if (lesser && loss < 0 && swapCheck)
+	// 4. When annealing, swaps that raise the loss are also accepted, with probability exp(-loss / temperature)
+	float temperature = /*$(Variable:temperature)*/;
+	bool uphill = loss >= 0 && temperature > 0.0f && wang_hash_float01(randomSeed) < exp(-loss / temperature);
+
+	bool candidate = lesser && loss < 0;
+	bool accepted = (candidate || (lesser && uphill)) && swapCheck;
+
+	if (accepted)
 	{
 		float4 value = SampleTexture[index];
 		float4 otherValue = SampleTexture[otherIndex];
 		SampleTexture[index] = otherValue;
 		SampleTexture[otherIndex] = value;
+	}
+
+	// 5. Reduce the swap statistics for the group, then add them to the totals for this iteration
+	uint threadIndex = GTid.y * 8 + GTid.x;
+	g_swapCounts[threadIndex] = uint3(accepted, candidate, accepted && uphill);
+	g_swapLoss[threadIndex] = accepted ? loss : 0.0f;
+	GroupMemoryBarrierWithGroupSync();
 
-		uint oldSwaps;
-		InterlockedAdd(Data[0].swaps, 1, oldSwaps);
+	for (uint stride = 32; stride > 0; stride /= 2)
+	{
+		if (threadIndex < stride)
+		{
+			g_swapCounts[threadIndex] += g_swapCounts[threadIndex + stride];
+			g_swapLoss[threadIndex] += g_swapLoss[threadIndex + stride];
+		}
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	if (threadIndex == 0 && g_swapCounts[0].x + g_swapCounts[0].y > 0)
+	{
+		uint oldValue;
+		InterlockedAdd(Data[0].swaps, g_swapCounts[0].x, oldValue);
+		InterlockedAdd(Data[0].candidates, g_swapCounts[0].y, oldValue);
+		InterlockedAdd(Data[0].uphillSwaps, g_swapCounts[0].z, oldValue);
 
+		// No float atomics, so the accepted loss is stored as float bits and accumulated with compare exchange
+		uint expected = Data[0].acceptedLoss;
+		[allow_uav_condition]
+		while (true)
+		{
+			InterlockedCompareExchange(Data[0].acceptedLoss, expected, asuint(asfloat(expected) + g_swapLoss[0]), oldValue);
+			if (oldValue == expected)
+				break;
+			expected = oldValue;
+		}
 	}
 	
 	// Output debugging info to a texture
@@ -1131,6 +1131,7 @@ namespace fastnoise
             context->m_internal.constantBuffer__SwapCB_cpu.key = context->m_input.variable_key;
             context->m_internal.constantBuffer__SwapCB_cpu.scrambleBits = context->m_input.variable_scrambleBits;
             context->m_internal.constantBuffer__SwapCB_cpu.swapSuppression = context->m_input.variable_swapSuppression;
+            context->m_internal.constantBuffer__SwapCB_cpu.temperature = context->m_input.variable_temperature;
             DX12Utils::CopyConstantsCPUToGPU(s_ubTracker, device, commandList, context->m_internal.constantBuffer__SwapCB, context->m_internal.constantBuffer__SwapCB_cpu, Context::LogFn);
         }
 
@@ -1293,7 +1294,7 @@ namespace fastnoise
             unsigned int baseCount = 1;
             unsigned int desiredCount = ((baseCount + 0 ) * 1) / 1 + 0;
             DXGI_FORMAT desiredFormat = DXGI_FORMAT_UNKNOWN;
-            unsigned int desiredStride = 12;
+            unsigned int desiredStride = 24;
 
             if(!m_output.buffer_Data ||
                m_output.buffer_Data_count != desiredCount ||
@@ -145,7 +145,8 @@ namespace fastnoise
             uint4 key = {0,0,0,0};  // Used for generating random permutations
             uint scrambleBits = 0;  // Number of bits to use in randomization
             uint swapSuppression = 64;
-            float2 _padding0 = {};  // Padding
+            float temperature = 0.000000f;  // Metropolis acceptance temperature for swaps that raise the loss. 0 only accepts swaps that lower it.
+            float _padding0 = 0.000000f;  // Padding
         };
 
         // For storing values of the loss function
@@ -57,6 +57,7 @@ namespace fastnoise
             int3 variable_filterMax = {{0,0,0}};  // Maximum range of the filter in each dimension
             int3 variable_filterOffset = {{0,0,0}};  // Offset into the filter buffer
             uint variable_swapSuppression = 64;
+            float variable_temperature = 0.000000f;  // Metropolis acceptance temperature for swaps that raise the loss. 0 only accepts swaps that lower it.
             FilterType variable_filterX = FilterType::Box;
             FilterType variable_filterY = FilterType::Box;
             FilterType variable_filterZ = FilterType::Box;
@@ -239,5 +240,8 @@ namespace fastnoise
         unsigned int initialized = false;
         uint iterationSum = 0;
         uint swaps = 0;
+        uint candidates = 0;  // Swaps that would lower the loss, before swap suppression
+        uint acceptedLoss = 0;  // Sum of the loss deltas of the accepted swaps, as float bits
+        uint uphillSwaps = 0;  // Accepted swaps that raised the loss, when annealing
     };
 };
@@ -9,6 +9,17 @@
 #include "DX12.h"
 #include "SImage.h"
 #include "SBuffer.h"
+#include "Annealing.h"
+#include "Energy.h"
+#include "Metrics.h"
+#include "OutputQueue.h"
+#include "SampleSpace.h"
+#include "VolumeTexture.h"
+#include "InitFile.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
 #include <random>
 #include <string>
 
@@ -19,7 +30,8 @@ enum ErrorCodes : int
     OK = 0,
     FilterTruncation,
     InitFileNoOpen,
-    InitFileWrongSize
+    InitFileWrongSize,
+    InitFileBadHeader
 };
 
 enum class OutputType
@@ -31,10 +43,24 @@ enum class OutputType
 
 std::string g_outputFileName;
 bool g_outputLayersAsSingleImages = false;
+bool g_exrParts = false;
+bool g_legacyChannels = false;
 size_t g_progress = 0;
 size_t g_numSteps = 10000;
 unsigned int g_seed = 0;
 const char* g_initFile = nullptr;
+AnnealingSchedule g_annealing;
+ReplicaLadder g_replicas;
+int g_restarts = 0;
+bool g_volumeOutput = false;
+VolumeTexture::Container g_volumeContainer = VolumeTexture::Container::DDS;
+VolumeTexture::Format g_volumeFormat = VolumeTexture::Format::RGBA8;
+bool g_halving = false;
+float g_timeLimit = 0.0f;
+bool g_calculateEnergy = false;
+size_t g_metricsInterval = 0;
+const char* g_traceFile = nullptr;
+bool g_useWarp = false;
 
 OutputType g_outputType = OutputType::Unspecified;
 
@@ -89,10 +115,70 @@ void PrintUsage()
         "  -seed <value>     - Force the random seed value. Makes process deterministic.\n"
         "\n"
         "  -init <filename>  - Load data for initial state instead of init.hlsl generating it. Binary\n"
-        "                      file must contain textureSize.x*textureSize.y*textureSize.z*4 floats.\n"
+        "                      file must contain textureSize.x*textureSize.y*textureSize.z*4 floats, or\n"
+        "                      start with an FNIT header and hold 1, 2 or 4 floats or halfs per pixel.\n"
         "\n"
         "  -progress <count> - Shows this many progress images before the end. Defaults to 0.\n"
         "\n"
+        "  -anneal <schedule> - Also accept swaps that raise the loss, with probability exp(-loss/temperature).\n"
+        "                      schedule can be:\n"
+        "                        geometric <startTemperature> <endTemperature>\n"
+        "                        adaptive <startTemperature> <acceptanceRate>\n"
+        "                      Adaptive adjusts the temperature so the fraction of uphill swaps accepted\n"
+        "                      falls linearly from acceptanceRate to 0. Without -anneal, only swaps that\n"
+        "                      lower the loss are accepted.\n"
+        "\n"
+        "  -replicas <count> <minTemperature> <maxTemperature> - Run count copies of the optimization at once, at\n"
+        "                      temperatures spaced geometrically from minTemperature to maxTemperature, and\n"
+        "                      periodically exchange neighbouring temperatures (parallel tempering). The\n"
+        "                      replica with the lowest energy is saved. Can't be combined with -anneal.\n"
+        "\n"
+        "  -exchange <steps>  - How many steps between replica exchanges. Defaults to numsteps/100.\n"
+        "\n"
+        "  -restarts <count>  - Run count seeds at once and save only the one with the lowest energy. The\n"
+        "                      winning seed is written to <fileName>.seed.txt.\n"
+        "\n"
+        "  -halving          - With -restarts, drop the worse half of the runs at evenly spaced points\n"
+        "                      through the optimization (successive halving).\n"
+        "\n"
+        "  -timelimit <seconds> - Stop optimizing after this much time, even if numsteps isn't reached.\n"
+        "\n"
+        "  -energy           - Calculate and print the energy (loss per pixel) of the final texture.\n"
+        "\n"
+        "  -metrics <steps>  - Every this many steps, and at the end, measure the noise on the CPU and add a line\n"
+        "                      of JSON to <fileName>.metrics.jsonl: the RMS error of random threshold masks under\n"
+        "                      the filter being optimized for, their power at low frequencies relative to white\n"
+        "                      noise, and the fraction of attempted swaps that were accepted.\n"
+        "\n"
+        "  -trace <file>     - Time each step's phases (GPU passes, readback, conversion, file writing...) and\n"
+        "                      write them to <file> in Chrome's trace event format, for chrome://tracing or\n"
+        "                      Perfetto. A table of the time spent in each phase is printed at the end.\n"
+        "\n"
+        "  -warp             - Run on WARP, D3D12's software rasterizer, instead of the GPU. Much slower, but\n"
+        "                      works on machines without a D3D12 GPU.\n"
+        "\n"
+        "  -volume <container> <format> - Write the final texture as a 3D volume texture instead of an image.\n"
+        "                      container is dds or ktx2. format is one of r8, rg8, rgba8, r16f, rgba16f,\n"
+        "                      bc4, bc5, bc7. Channels beyond what the format holds are dropped.\n"
+        "\n"
+        "  -pngfilter <filter> - PNG row filter: none, sub, up, average, paeth or adaptive. Defaults to adaptive.\n"
+        "\n"
+        "  -pnglevel <level> - PNG compression level from 0 (store) to 10 (smallest). Defaults to 6.\n"
+        "\n"
+        "  -exrhalf          - Write EXRs as half floats, unless the noise is a scalar with more values than\n"
+        "                      half can tell apart.\n"
+        "\n"
+        "  -exrcompression <compression> - EXR compression: none, zip or piz. Defaults to none.\n"
+        "\n"
+        "  -exrparts         - With -split and exr output, write the slices as the parts of one multi-part\n"
+        "                      EXR instead of a file each.\n"
+        "\n"
+        "  -legacychannels   - Save all 4 channels of the texture. By default only the channels the sample\n"
+        "                      space uses are saved: 1 for real and circle, 2 for vector2, 3 for vector3\n"
+        "                      and sphere, 4 for vector4. 2 channel PNGs are stored as grey+alpha.\n"
+        "\n"
+        "  -f32              - With csv output, also write the raw floats to a .f32 file next to each csv.\n"
+        "\n"
         "Parameter Explanation:\n"
         "- Box size is diameter, so 3 gives you 3x3, 5 gives you 5x5 etc.\n"
         "- Binomial N is the N in N choose K, so 2 gives 3x3, 4 gives 5x5 etc.\n"
@@ -115,6 +201,14 @@ void PrintUsage()
     );
 }
 
+// Scalar distributions are stored as (f, f, f, 1)
+static bool IsScalarDistribution(fastnoise::SampleDistribution distribution)
+{
+    return distribution == fastnoise::SampleDistribution::Uniform1D ||
+        distribution == fastnoise::SampleDistribution::Gauss1D ||
+        distribution == fastnoise::SampleDistribution::Tent1D;
+}
+
 bool ParseCommandLine(fastnoise::Context::ContextInput& settings, int argc, char** argv)
 {
     int nextArg = 1;
@@ -464,6 +558,226 @@ bool ParseCommandLine(fastnoise::Context::ContextInput& settings, int argc, char
                 return false;
             }
         }
+        else if (!_stricmp(argv[nextArg], "-anneal"))
+        {
+            nextArg++;
+            if (nextArg + 2 >= argc)
+            {
+                printf("[Error] -anneal is missing the schedule and its parameters\n");
+                return false;
+            }
+
+            if (!_stricmp(argv[nextArg], "geometric"))
+                g_annealing.m_type = AnnealingSchedule::Type::Geometric;
+            else if (!_stricmp(argv[nextArg], "adaptive"))
+                g_annealing.m_type = AnnealingSchedule::Type::Adaptive;
+            else
+            {
+                printf("[Error] Unknown -anneal schedule: \"%s\"\n", argv[nextArg]);
+                return false;
+            }
+
+            if (sscanf_s(argv[nextArg + 1], "%f", &g_annealing.m_startTemperature) != 1 || sscanf_s(argv[nextArg + 2], "%f", &g_annealing.m_param) != 1 ||
+                g_annealing.m_startTemperature <= 0.0f || g_annealing.m_param <= 0.0f)
+            {
+                printf("[Error] -anneal parameters must be positive numbers\n");
+                return false;
+            }
+            nextArg += 3;
+        }
+        else if (!_stricmp(argv[nextArg], "-replicas"))
+        {
+            nextArg++;
+            if (nextArg + 2 >= argc)
+            {
+                printf("[Error] -replicas is missing the count and temperatures\n");
+                return false;
+            }
+
+            if (sscanf_s(argv[nextArg], "%i", &g_replicas.m_count) != 1 || sscanf_s(argv[nextArg + 1], "%f", &g_replicas.m_minTemperature) != 1 ||
+                sscanf_s(argv[nextArg + 2], "%f", &g_replicas.m_maxTemperature) != 1 ||
+                g_replicas.m_count < 1 || g_replicas.m_minTemperature <= 0.0f || g_replicas.m_maxTemperature < g_replicas.m_minTemperature)
+            {
+                printf("[Error] -replicas needs a positive count and 0 < minTemperature <= maxTemperature\n");
+                return false;
+            }
+            nextArg += 3;
+        }
+        else if (!_stricmp(argv[nextArg], "-exchange"))
+        {
+            nextArg++;
+            int exchangeInterval = 0;
+            if (nextArg < argc && sscanf_s(argv[nextArg], "%i", &exchangeInterval) == 1 && exchangeInterval > 0)
+            {
+                g_replicas.m_exchangeInterval = exchangeInterval;
+                nextArg++;
+            }
+            else
+            {
+                printf("[Error] -exchange is missing the number of steps\n");
+                return false;
+            }
+        }
+        else if (!_stricmp(argv[nextArg], "-restarts"))
+        {
+            nextArg++;
+            if (nextArg < argc && sscanf_s(argv[nextArg], "%i", &g_restarts) == 1 && g_restarts > 0)
+            {
+                nextArg++;
+            }
+            else
+            {
+                printf("[Error] -restarts is missing the number of seeds\n");
+                return false;
+            }
+        }
+        else if (!_stricmp(argv[nextArg], "-halving"))
+        {
+            g_halving = true;
+            nextArg++;
+        }
+        else if (!_stricmp(argv[nextArg], "-timelimit"))
+        {
+            nextArg++;
+            if (nextArg < argc && sscanf_s(argv[nextArg], "%f", &g_timeLimit) == 1)
+            {
+                nextArg++;
+            }
+            else
+            {
+                printf("[Error] -timelimit is missing the number of seconds\n");
+                return false;
+            }
+        }
+        else if (!_stricmp(argv[nextArg], "-energy"))
+        {
+            g_calculateEnergy = true;
+            nextArg++;
+        }
+        else if (!_stricmp(argv[nextArg], "-metrics"))
+        {
+            nextArg++;
+            int metricsInterval = 0;
+            if (nextArg < argc && sscanf_s(argv[nextArg], "%i", &metricsInterval) == 1 && metricsInterval > 0)
+            {
+                g_metricsInterval = metricsInterval;
+                nextArg++;
+            }
+            else
+            {
+                printf("[Error] -metrics is missing the number of steps between measurements\n");
+                return false;
+            }
+        }
+        else if (!_stricmp(argv[nextArg], "-trace"))
+        {
+            nextArg++;
+            if (nextArg < argc)
+            {
+                g_traceFile = argv[nextArg];
+                nextArg++;
+            }
+            else
+            {
+                printf("[Error] -trace is missing the filename argument\n");
+                return false;
+            }
+        }
+        else if (!_stricmp(argv[nextArg], "-warp"))
+        {
+            g_useWarp = true;
+            nextArg++;
+        }
+        else if (!_stricmp(argv[nextArg], "-volume"))
+        {
+            nextArg++;
+            if (nextArg + 1 >= argc)
+            {
+                printf("[Error] -volume is missing the container and format\n");
+                return false;
+            }
+
+            if (!VolumeTexture::ContainerFromString(argv[nextArg], g_volumeContainer))
+            {
+                printf("[Error] Unknown -volume container: \"%s\"\n", argv[nextArg]);
+                return false;
+            }
+
+            if (!VolumeTexture::FormatFromString(argv[nextArg + 1], g_volumeFormat))
+            {
+                printf("[Error] Unknown -volume format: \"%s\"\n", argv[nextArg + 1]);
+                return false;
+            }
+
+            g_volumeOutput = true;
+            nextArg += 2;
+        }
+        else if (!_stricmp(argv[nextArg], "-pngfilter"))
+        {
+            nextArg++;
+            if (nextArg >= argc || !PNGEncoder::FilterFromString(argv[nextArg], SImage::s_pngSettings.filter))
+            {
+                printf("[Error] -pngfilter is missing the filter, or it isn't one of none, sub, up, average, paeth, adaptive\n");
+                return false;
+            }
+            nextArg++;
+        }
+        else if (!_stricmp(argv[nextArg], "-pnglevel"))
+        {
+            nextArg++;
+            if (nextArg < argc && sscanf_s(argv[nextArg], "%i", &SImage::s_pngSettings.compressionLevel) == 1 &&
+                SImage::s_pngSettings.compressionLevel >= 0 && SImage::s_pngSettings.compressionLevel <= 10)
+            {
+                nextArg++;
+            }
+            else
+            {
+                printf("[Error] -pnglevel is missing a level from 0 to 10\n");
+                return false;
+            }
+        }
+        else if (!_stricmp(argv[nextArg], "-exrhalf"))
+        {
+            SImage::s_exrSettings.half = true;
+            nextArg++;
+        }
+        else if (!_stricmp(argv[nextArg], "-exrcompression"))
+        {
+            nextArg++;
+            if (nextArg >= argc)
+            {
+                printf("[Error] -exrcompression is missing the compression\n");
+                return false;
+            }
+
+            if (!_stricmp(argv[nextArg], "none"))
+                SImage::s_exrSettings.compression = SImage::EXRCompression::None;
+            else if (!_stricmp(argv[nextArg], "zip"))
+                SImage::s_exrSettings.compression = SImage::EXRCompression::ZIP;
+            else if (!_stricmp(argv[nextArg], "piz"))
+                SImage::s_exrSettings.compression = SImage::EXRCompression::PIZ;
+            else
+            {
+                printf("[Error] Unknown -exrcompression: \"%s\"\n", argv[nextArg]);
+                return false;
+            }
+            nextArg++;
+        }
+        else if (!_stricmp(argv[nextArg], "-exrparts"))
+        {
+            g_exrParts = true;
+            nextArg++;
+        }
+        else if (!_stricmp(argv[nextArg], "-legacychannels"))
+        {
+            g_legacyChannels = true;
+            nextArg++;
+        }
+        else if (!_stricmp(argv[nextArg], "-f32"))
+        {
+            SImage::s_writeF32Sidecar = true;
+            nextArg++;
+        }
         else if (!_stricmp(argv[nextArg], "-output"))
         {
             nextArg++;
@@ -492,9 +806,112 @@ bool ParseCommandLine(fastnoise::Context::ContextInput& settings, int argc, char
         }
     }
 
+    if (g_replicas.m_count > 0 && g_annealing.m_type != AnnealingSchedule::Type::None)
+    {
+        printf("[Error] -replicas and -anneal can't be used together\n");
+        return false;
+    }
+
+    if (g_replicas.m_count > 0 && g_restarts > 0)
+    {
+        printf("[Error] -replicas and -restarts can't be used together\n");
+        return false;
+    }
+
+    // Scalar noise is stratified, one value per pixel, and thresholding it relies on the values staying distinct.
+    // Half only has 1024 values in [0.5, 1), so beyond 2048 pixels neighbouring values would merge.
+    if (SImage::s_exrSettings.half)
+    {
+        bool scalar = IsScalarDistribution(settings.variable_sampleDistribution);
+        unsigned int pixels = settings.variable_TextureSize[0] * settings.variable_TextureSize[1] * settings.variable_TextureSize[2];
+        if (scalar && pixels > 2048)
+        {
+            printf("[Warning] -exrhalf ignored: half can't keep %u scalar values distinct, writing float.\n", pixels);
+            SImage::s_exrSettings.half = false;
+        }
+    }
+
     return true;
 }
 
+// Transitions a resource around a readback, when its ending state isn't already the one needed
+static void TransitionResource(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* resource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+{
+    if (stateBefore == stateAfter)
+        return;
+
+    D3D12_RESOURCE_BARRIER barrier;
+    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    barrier.Transition.pResource = resource;
+    barrier.Transition.StateBefore = stateBefore;
+    barrier.Transition.StateAfter = stateAfter;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    cmdList->ResourceBarrier(1, &barrier);
+}
+
+// Writes the winning seed of -restarts next to the output, with a command line that reproduces it as a single run
+static void SaveSeedFile(unsigned int seed, double energy, int argc, char** argv)
+{
+    char fileName[256];
+    sprintf_s(fileName, "%s.seed.txt", g_outputFileName.c_str());
+
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "wb");
+    if (!file)
+    {
+        printf("[Error] Could not open file for writing \"%s\".\n", fileName);
+        return;
+    }
+
+    fprintf(file, "seed = %u\nenergy = %f\n", seed, energy);
+
+    // Drop the options that choose between seeds, and any seed given, then pin the winning one
+    std::string commandLine;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (!_stricmp(argv[i], "-restarts") || !_stricmp(argv[i], "-seed"))
+        {
+            i++;
+            continue;
+        }
+        if (!_stricmp(argv[i], "-halving"))
+            continue;
+
+        if (!commandLine.empty())
+            commandLine += " ";
+        commandLine += argv[i];
+    }
+    fprintf(file, "%s -seed %u\n", commandLine.c_str(), seed);
+
+    fclose(file);
+}
+
+// One optimization running in its own fastnoise context. There is more than one when using -replicas or -restarts.
+struct Run
+{
+    ~Run()
+    {
+        if (m_context)
+            fastnoise::DestroyContext(m_context);
+    }
+
+    fastnoise::Context* m_context = nullptr;
+    unsigned int m_seed = 0;
+    std::mt19937 m_rng;
+    AnnealingSchedule m_annealing;
+
+    // The temperature of this run, and where it is on the replica ladder (0 is coldest)
+    float m_temperature = 0.0f;
+    int m_temperatureIndex = 0;
+
+    SImage m_texture;
+    SBuffer<fastnoise::Struct_DataStruct> m_data;
+
+    // Only calculated when needed
+    double m_energy = 0.0;
+};
+
 inline void StringReplaceAll(std::string& str, const std::string& from, const std::string& to) {
     if (from.empty())
         return;
@@ -507,19 +924,11 @@ inline void StringReplaceAll(std::string& str, const std::string& from, const st
 
 int main(int argc, char** argv)
 {
-    // initialize directx
-    DX12 dx12;
+    fastnoise::Context::LogFn = &LogFn;
+    fastnoise::Context::s_techniqueLocation = L"fastnoise/";
 
-    // create the context
-    fastnoise::Context* fastnoiseContext = nullptr;
-    {
-        fastnoise::Context::LogFn = &LogFn;
-        fastnoise::Context::s_techniqueLocation = L"fastnoise/";
-        fastnoiseContext = fastnoise::CreateContext(dx12.m_device);
-        if (!fastnoiseContext)
-            Assert(false, "Could not create fastnoise context");
-        fastnoiseContext->m_profile = false;
-    }
+    // The settings every run starts from
+    fastnoise::Context::ContextInput settings;
 
     // Set a random seed. This can be overridden by the "-seed" command line parameter.
     {
@@ -528,70 +937,58 @@ int main(int argc, char** argv)
     }
 
     // read the command line
-    if (!ParseCommandLine(fastnoiseContext->m_input, argc, argv))
+    if (!ParseCommandLine(settings, argc, argv))
     {
         PrintUsage();
         return 1;
     }
 
-    // Initialize RNG
-    std::mt19937 rng(g_seed);
-    std::uniform_int_distribution<unsigned int> dist(0);
+    // initialize directx
+    DX12 dx12(g_useWarp);
+
+    if (g_traceFile)
+        Trace::Start();
+    Trace::Scope setupScope("setup");
 
     StringReplaceAll(g_outputFileName, "%", "_");
     printf("%s...\n", g_outputFileName.c_str());
 
-    // random seed
-    fastnoiseContext->m_input.variable_rngSeed = dist(rng);
-    fastnoiseContext->m_input.variable_scrambleBits = (unsigned int)std::min(std::log2(float(fastnoiseContext->m_input.variable_TextureSize[0])), std::log2(float(fastnoiseContext->m_input.variable_TextureSize[0])));
+    // Only save the channels the sample space uses. The rest are copies, 0 or 1.
+    if (!g_legacyChannels)
+        SImage::s_saveComponents = SampleSpaceComponents(settings.variable_sampleSpace);
+
+    settings.variable_scrambleBits = (unsigned int)std::min(std::log2(float(settings.variable_TextureSize[0])), std::log2(float(settings.variable_TextureSize[0])));
 
-    fastnoiseContext->m_input.variable_swapSuppression = 8;
+    settings.variable_swapSuppression = 8;
 
-    // Load initialization buffer, or create a dummy one if none specified
+    // Map the initialization file, or create a dummy buffer if none specified.
+    // The file is expanded to float4s straight from the mapping into the upload heap, when the buffer is uploaded.
     SBuffer<float> initBuffer;
-    std::vector<float> initData;
+    InitFile initFile;
     {
         if (g_initFile != nullptr)
         {
-            // open the file if we can
-            FILE* file = nullptr;
-            fopen_s(&file, g_initFile, "rb");
-            if (!file)
-            {
-                printf("[Error] Could not open init file for reading \"%s\".\n", g_initFile);
-                return ErrorCodes::InitFileNoOpen;
-            }
-
-            // load the file data into memory and close it
-            std::vector<unsigned char> fileData;
-            fseek(file, 0, SEEK_END);
-            fileData.resize(ftell(file));
-            fseek(file, 0, SEEK_SET);
-            fread(fileData.data(), fileData.size(), 1, file);
-            fclose(file);
-
-            size_t desiredPixelCount = fastnoiseContext->m_input.variable_TextureSize[0] * fastnoiseContext->m_input.variable_TextureSize[1] * fastnoiseContext->m_input.variable_TextureSize[2];
-            size_t desiredByteCount = desiredPixelCount * sizeof(float) * 4;
-
-            if (fileData.size() != desiredByteCount)
+            char error[1024];
+            InitFile::Result result = initFile.Open(g_initFile, settings.variable_TextureSize.data(), error, sizeof(error));
+            if (result != InitFile::Result::OK)
             {
-                printf("[Error] init file was wrong size: %zu bytes instead of %zu bytes.\n", fileData.size(), desiredByteCount);
-                return ErrorCodes::InitFileWrongSize;
+                printf("[Error] %s\n", error);
+                switch (result)
+                {
+                    case InitFile::Result::NoOpen: return ErrorCodes::InitFileNoOpen;
+                    case InitFile::Result::BadHeader: return ErrorCodes::InitFileBadHeader;
+                    default: return ErrorCodes::InitFileWrongSize;
+                }
             }
 
-            initData.resize(desiredPixelCount * 4);
-            memcpy(initData.data(), fileData.data(), desiredByteCount);
+            initBuffer.Create(dx12.m_device, initFile.GetPixelCount() * 4, "Init Buffer");
         }
         else
         {
             // Dummy buffer data. It won't be used, but still needs to exist.
-            initData.push_back(0.0f);
-            initData.push_back(0.0f);
-            initData.push_back(0.0f);
-            initData.push_back(0.0f);
+            float initData[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            initBuffer.Load(dx12.m_device, initData, "Init Buffer");
         }
-
-        initBuffer.Load(dx12.m_device, &initData[0], initData.size(), "Init Buffer");
     }
 
     // 
@@ -599,8 +996,8 @@ int main(int argc, char** argv)
     {
         std::vector<float> filterData;
 
-        fastnoise::FilterType filterTypes[3] = { fastnoiseContext->m_input.variable_filterX, fastnoiseContext->m_input.variable_filterY, fastnoiseContext->m_input.variable_filterZ };
-        fastnoise::float4 filterParams[3] = { fastnoiseContext->m_input.variable_filterXparams, fastnoiseContext->m_input.variable_filterYparams, fastnoiseContext->m_input.variable_filterZparams };
+        fastnoise::FilterType filterTypes[3] = { settings.variable_filterX, settings.variable_filterY, settings.variable_filterZ };
+        fastnoise::float4 filterParams[3] = { settings.variable_filterXparams, settings.variable_filterYparams, settings.variable_filterZparams };
 
         for (int c = 0; c < 3; c++)
         {
@@ -616,9 +1013,9 @@ int main(int argc, char** argv)
                 Assert(boxFilterSize > 0, "Box filter parameter 0 (boxFilterSize) must be positive");
 
                 #if 1
-                fastnoiseContext->m_input.variable_filterMin[c] = -(boxFilterSize - 1);
-                fastnoiseContext->m_input.variable_filterMax[c] = boxFilterSize - 1;
-                fastnoiseContext->m_input.variable_filterOffset[c] = (int)(filterData.size() + boxFilterSize - 1);
+                settings.variable_filterMin[c] = -(boxFilterSize - 1);
+                settings.variable_filterMax[c] = boxFilterSize - 1;
+                settings.variable_filterOffset[c] = (int)(filterData.size() + boxFilterSize - 1);
 
                 for (int i = -(boxFilterSize - 1); i <= boxFilterSize - 1; i++)
                 {
@@ -629,9 +1026,9 @@ int main(int argc, char** argv)
                 #else
                 // For small textures, this can be desirable. Otherwise the filter would get truncated, which results in an error below.
 
-                fastnoiseContext->m_input.variable_filterMin[c] = -boxFilterSize / 2;
-                fastnoiseContext->m_input.variable_filterMax[c] = fastnoiseContext->m_input.variable_filterMin[c] + boxFilterSize - 1;
-                fastnoiseContext->m_input.variable_filterOffset[c] = (int)(filterData.size() + boxFilterSize - 1);
+                settings.variable_filterMin[c] = -boxFilterSize / 2;
+                settings.variable_filterMax[c] = settings.variable_filterMin[c] + boxFilterSize - 1;
+                settings.variable_filterOffset[c] = (int)(filterData.size() + boxFilterSize - 1);
 
                 for (int i = 0; i < boxFilterSize; ++i)
                     filterData.push_back(1.0f / float(boxFilterSize));
@@ -647,9 +1044,9 @@ int main(int argc, char** argv)
                 int binomialFilterSize = (int)filterParam[0];
                 Assert(binomialFilterSize > 0, "Binomial filter parameter 0 (binomialFilterSize) must be positive");
 
-                fastnoiseContext->m_input.variable_filterMin[c] = -binomialFilterSize;
-                fastnoiseContext->m_input.variable_filterMax[c] = binomialFilterSize;
-                fastnoiseContext->m_input.variable_filterOffset[c] = (int)(filterData.size() + binomialFilterSize);
+                settings.variable_filterMin[c] = -binomialFilterSize;
+                settings.variable_filterMax[c] = binomialFilterSize;
+                settings.variable_filterOffset[c] = (int)(filterData.size() + binomialFilterSize);
 
                 // Precomputed normalization of the filter
                 float filterPow = pow(0.5f, 2.0f * float(binomialFilterSize));
@@ -693,9 +1090,9 @@ int main(int argc, char** argv)
                 // Determines the min/max extents of the filter (inclusive)
                 int filterSize = 2 * ((int)filter.size() - 1);
 
-                fastnoiseContext->m_input.variable_filterMin[c] = -filterSize;
-                fastnoiseContext->m_input.variable_filterMax[c] = filterSize;
-                fastnoiseContext->m_input.variable_filterOffset[c] = (int)filterData.size() + filterSize;
+                settings.variable_filterMin[c] = -filterSize;
+                settings.variable_filterMax[c] = filterSize;
+                settings.variable_filterOffset[c] = (int)filterData.size() + filterSize;
 
                 // Calculate the convolution of the filter f with itself
                 for (int i = -filterSize; i <= filterSize; i++)
@@ -717,13 +1114,13 @@ int main(int argc, char** argv)
             {
                 float alpha = filterParam[0];
                 float beta = filterParam[1];
-                int size = fastnoiseContext->m_input.variable_TextureSize[c];
+                int size = settings.variable_TextureSize[c];
                 int offset = (int)filterData.size();
 
                 // For temporal filter, start offset at zero 
-                fastnoiseContext->m_input.variable_filterMin[c] = 0;
-                fastnoiseContext->m_input.variable_filterMax[c] = size-1;
-                fastnoiseContext->m_input.variable_filterOffset[c] = offset;
+                settings.variable_filterMin[c] = 0;
+                settings.variable_filterMax[c] = size-1;
+                settings.variable_filterOffset[c] = offset;
 
                 filterData.insert(filterData.end(), size, 0.0f);
 
@@ -772,14 +1169,72 @@ int main(int argc, char** argv)
             if (filterTypes[c] == fastnoise::FilterType::WeightedExponential || filterTypes[c] == fastnoise::FilterType::Exponential)
                 continue;
 
-            if ((int)fastnoiseContext->m_input.variable_TextureSize[c] < 1 + fastnoiseContext->m_input.variable_filterMax[c] - fastnoiseContext->m_input.variable_filterMin[c])
+            if ((int)settings.variable_TextureSize[c] < 1 + settings.variable_filterMax[c] - settings.variable_filterMin[c])
             {
-                printf("[Error] Filter Truncation: filter on axis %i is of size %i, but the texture is only %i.\n", c, 1 + fastnoiseContext->m_input.variable_filterMax[c] - fastnoiseContext->m_input.variable_filterMin[c], (int)fastnoiseContext->m_input.variable_TextureSize[c]);
+                printf("[Error] Filter Truncation: filter on axis %i is of size %i, but the texture is only %i.\n", c, 1 + settings.variable_filterMax[c] - settings.variable_filterMin[c], (int)settings.variable_TextureSize[c]);
                 return ErrorCodes::FilterTruncation;
             }
         }
     }
 
+    // What a step does, so tools reading the trace can work out rates. filterTaps is how many taps the loss visits per
+    // pixel, which follows useWindowedLoss() in loss.hlsl: small XY footprints only visit the XY window, plus the rest of
+    // the centre column in separate mode, and everything else visits every tap of the filter's box.
+    if (Trace::IsEnabled())
+    {
+        int filterSize[3];
+        for (int c = 0; c < 3; c++)
+            filterSize[c] = 1 + settings.variable_filterMax[c] - settings.variable_filterMin[c];
+
+        static const int c_windowMaxFootprint = 7;
+        bool windowed = filterSize[0] <= c_windowMaxFootprint && filterSize[1] <= c_windowMaxFootprint;
+        if (settings.variable_separate)
+            windowed = windowed && settings.variable_filterMin[2] <= 0 && settings.variable_filterMax[2] >= 0;
+        else
+            windowed = windowed && filterSize[2] == 1;
+
+        double filterTaps = double(filterSize[0]) * double(filterSize[1]);
+        if (!windowed)
+            filterTaps *= double(filterSize[2]);
+        else if (settings.variable_separate)
+            filterTaps += double(filterSize[2] - 1);
+
+        Trace::SetValue("pixels", double(settings.variable_TextureSize[0]) * double(settings.variable_TextureSize[1]) * double(settings.variable_TextureSize[2]));
+        Trace::SetValue("filterTaps", filterTaps);
+        Trace::SetValue("steps", double(g_numSteps));
+    }
+
+    // Create the runs. A single run is seeded exactly as FastNoise always has been, so -seed reproduces older results.
+    std::vector<std::unique_ptr<Run>> runs;
+    {
+        std::mt19937 seedRNG(g_seed);
+        std::vector<float> ladder = g_replicas.GetTemperatures();
+
+        int runCount = std::max(std::max(g_replicas.m_count, g_restarts), 1);
+        for (int runIndex = 0; runIndex < runCount; ++runIndex)
+        {
+            std::unique_ptr<Run> run = std::make_unique<Run>();
+            run->m_seed = (runIndex == 0) ? g_seed : seedRNG();
+            run->m_rng.seed(run->m_seed);
+            run->m_annealing = g_annealing;
+            run->m_annealing.Start();
+            run->m_temperatureIndex = runIndex;
+            if (!ladder.empty())
+                run->m_temperature = ladder[runIndex];
+
+            run->m_context = fastnoise::CreateContext(dx12.m_device);
+            if (!run->m_context)
+                Assert(false, "Could not create fastnoise context");
+            run->m_context->m_profile = Trace::IsEnabled();
+            run->m_context->m_input = settings;
+
+            std::uniform_int_distribution<unsigned int> dist(0);
+            run->m_context->m_input.variable_rngSeed = dist(run->m_rng);
+
+            runs.push_back(std::move(run));
+        }
+    }
+
     // Iterate
     {
         const size_t c_imageReadbackInterval = g_progress > 0
@@ -788,122 +1243,268 @@ int main(int argc, char** argv)
 
         const size_t c_statusReportInterval = std::max<size_t>(g_numSteps / 100, 1);
 
-        SImage fastnoiseTexture;
-        SBuffer<fastnoise::Struct_DataStruct> fastnoiseData;
-        for (int step = 0; step < g_numSteps; ++step)
+        const size_t c_exchangeInterval = g_replicas.m_count > 1
+            ? (g_replicas.m_exchangeInterval > 0 ? g_replicas.m_exchangeInterval : c_statusReportInterval)
+            : 0;
+
+        // Exchange statistics between neighbouring temperatures, for reporting
+        size_t exchangesAttempted = 0;
+        size_t exchangesAccepted = 0;
+
+        std::mt19937 exchangeRNG(g_seed);
+
+        // Successive halving drops the worse half of the runs at evenly spaced points, until one is left
+        int halvingRounds = 0;
+        if (g_halving && runs.size() > 1)
+            halvingRounds = (int)std::ceil(std::log2(float(runs.size())));
+        int halvingRound = 0;
+
+        // Images are encoded and written on worker threads. This caps how much memory the copies waiting to be written can use.
+        static const size_t c_outputQueueBudgetBytes = 1024 * 1024 * 1024;
+        OutputQueue outputQueue(c_outputQueueBudgetBytes);
+
+        // -metrics writes a line of JSON per measurement, flushed as it goes so a run can be watched or stopped early
+        FILE* metricsFile = nullptr;
+        if (g_metricsInterval > 0)
         {
-            bool readbackImage = (step == (g_numSteps - 1));
+            char fileName[256];
+            sprintf_s(fileName, "%s.metrics.jsonl", g_outputFileName.c_str());
+            fopen_s(&metricsFile, fileName, "wb");
+            if (!metricsFile)
+                printf("[Error] Could not open file for writing \"%s\".\n", fileName);
+        }
+
+        // Time spent measuring, which the times in the metrics leave out
+        double metricsSeconds = 0.0;
+
+        std::uniform_int_distribution<unsigned int> dist(0);
+        std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+        bool lastStep = false;
+        setupScope.End();
+        for (int step = 0; !lastStep; ++step)
+        {
+            Trace::Scope stepScope("step", "cpu", step);
+
+            // How far through the optimization we are, by step count or by time if there is a time limit
+            float progress = (g_numSteps > 1) ? float(step) / float(g_numSteps - 1) : 1.0f;
+            if (g_timeLimit > 0.0f)
+            {
+                float elapsedSeconds = std::chrono::duration_cast<std::chrono::duration<float>>(std::chrono::high_resolution_clock::now() - startTime).count();
+                progress = std::max(progress, elapsedSeconds / g_timeLimit);
+            }
+            progress = std::min(progress, 1.0f);
+            lastStep = (size_t(step) + 1 >= g_numSteps) || progress >= 1.0f;
+
+            bool saveImage = lastStep;
             if (g_progress > 0)
-                readbackImage |= ((step % c_imageReadbackInterval) == 0);
+                saveImage |= ((step % c_imageReadbackInterval) == 0);
+
+            bool exchange = !lastStep && c_exchangeInterval > 0 && step > 0 && (step % c_exchangeInterval) == 0;
+
+            bool halve = !lastStep && halvingRound < halvingRounds && progress >= float(halvingRound + 1) / float(halvingRounds + 1);
+
+            // Replica exchange and halving need every texture to evaluate the energies
+            bool readbackImage = saveImage || exchange || halve;
+
+            bool readbackBuffer = ((step % c_statusReportInterval) == 0) || lastStep;
 
-            bool readbackBuffer = ((step % c_statusReportInterval) == 0) || step == (g_numSteps - 1);
+            bool measure = metricsFile && (((step % g_metricsInterval) == 0) || lastStep);
+            readbackImage |= measure;
+
+            // The metrics need the swap statistics too, but only status reports adjust the swap suppression and temperature
+            bool readbackData = readbackBuffer || measure;
+
+            for (std::unique_ptr<Run>& run : runs)
+            {
+                if (g_replicas.m_count == 0)
+                    run->m_temperature = run->m_annealing.GetTemperature(progress);
+                run->m_context->m_input.variable_temperature = run->m_temperature;
+            }
 
             // DEBUG: output every image
             //readbackImage = true;
 
+            Trace::Scope executeScope("execute", "cpu", step);
             dx12.Execute(
                 [&](ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
                 {
                     fastnoise::OnNewFrame(1);
 
-                    fastnoiseContext->m_input.variable_Iteration = step;
-
-                    // Set up key for Feistel network
-                    fastnoiseContext->m_input.variable_key[0] = dist(rng);
-                    fastnoiseContext->m_input.variable_key[1] = dist(rng);
-                    fastnoiseContext->m_input.variable_key[2] = dist(rng);
-                    fastnoiseContext->m_input.variable_key[3] = dist(rng);
-
                     if (step == 0)
                     {
-                        initBuffer.UploadDataToGPU(device, cmdList);
+                        if (g_initFile != nullptr)
+                        {
+                            initBuffer.UploadDataToGPU(device, cmdList,
+                                [&](float* dest)
+                                {
+                                    initFile.ExpandToFloat4(dest);
+                                }
+                            );
+                        }
+                        else
+                        {
+                            initBuffer.UploadDataToGPU(device, cmdList);
+                        }
                         filterBuffer.UploadDataToGPU(device, cmdList);
-
-                        fastnoiseContext->m_input.buffer_InitBuffer = initBuffer.m_resource;
-                        fastnoiseContext->m_input.buffer_InitBuffer_stride = 0;
-                        fastnoiseContext->m_input.buffer_InitBuffer_format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-                        fastnoiseContext->m_input.buffer_InitBuffer_count = (unsigned int)initBuffer.m_data.size() / 4;
-                        fastnoiseContext->m_input.buffer_InitBuffer_state = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-
-                        fastnoiseContext->m_input.buffer_Filter = filterBuffer.m_resource;
-                        fastnoiseContext->m_input.buffer_Filter_stride = 0;
-                        fastnoiseContext->m_input.buffer_Filter_format = DXGI_FORMAT_R32_FLOAT;
-                        fastnoiseContext->m_input.buffer_Filter_count = (unsigned int)filterBuffer.m_data.size();
-                        fastnoiseContext->m_input.buffer_Filter_state = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
                     }
 
-                    fastnoise::Execute(fastnoiseContext, device, cmdList);
-
-                    if (step == 0)
+                    for (std::unique_ptr<Run>& run : runs)
                     {
-                        fastnoiseTexture.AdoptResource(fastnoiseContext->m_output.texture_Texture, fastnoiseContext->m_input.variable_TextureSize[0], fastnoiseContext->m_input.variable_TextureSize[1] * fastnoiseContext->m_input.variable_TextureSize[2], 4, DXGI_FORMAT_R32G32B32A32_FLOAT, sizeof(float));
-                        fastnoiseData.AdoptResource(fastnoiseContext->m_output.buffer_Data, fastnoiseContext->m_output.buffer_Data_count);
-                    }
+                        fastnoise::Context* fastnoiseContext = run->m_context;
 
-                    if (readbackImage)
-                    {
-                        if (fastnoiseContext->m_output.c_texture_Texture_endingState != D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+                        fastnoiseContext->m_input.variable_Iteration = step;
+
+                        // Set up key for Feistel network
+                        fastnoiseContext->m_input.variable_key[0] = dist(run->m_rng);
+                        fastnoiseContext->m_input.variable_key[1] = dist(run->m_rng);
+                        fastnoiseContext->m_input.variable_key[2] = dist(run->m_rng);
+                        fastnoiseContext->m_input.variable_key[3] = dist(run->m_rng);
+
+                        if (step == 0)
                         {
-                            D3D12_RESOURCE_BARRIER barrier;
-                            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-                            barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-                            barrier.Transition.pResource = fastnoiseContext->m_output.texture_Texture;
-                            barrier.Transition.StateBefore = fastnoiseContext->m_output.c_texture_Texture_endingState;
-                            barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-                            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-                            cmdList->ResourceBarrier(1, &barrier);
+                            fastnoiseContext->m_input.buffer_InitBuffer = initBuffer.m_resource;
+                            fastnoiseContext->m_input.buffer_InitBuffer_stride = 0;
+                            fastnoiseContext->m_input.buffer_InitBuffer_format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+                            fastnoiseContext->m_input.buffer_InitBuffer_count = (unsigned int)initBuffer.m_count / 4;
+                            fastnoiseContext->m_input.buffer_InitBuffer_state = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+                            fastnoiseContext->m_input.buffer_Filter = filterBuffer.m_resource;
+                            fastnoiseContext->m_input.buffer_Filter_stride = 0;
+                            fastnoiseContext->m_input.buffer_Filter_format = DXGI_FORMAT_R32_FLOAT;
+                            fastnoiseContext->m_input.buffer_Filter_count = (unsigned int)filterBuffer.m_data.size();
+                            fastnoiseContext->m_input.buffer_Filter_state = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
                         }
 
-                        fastnoiseTexture.RequestReadback(device, cmdList);
+                        fastnoise::Execute(fastnoiseContext, device, cmdList);
 
-                        if (fastnoiseContext->m_output.c_texture_Texture_endingState != D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+                        if (step == 0)
                         {
-                            D3D12_RESOURCE_BARRIER barrier;
-                            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-                            barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-                            barrier.Transition.pResource = fastnoiseContext->m_output.texture_Texture;
-                            barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-                            barrier.Transition.StateAfter = fastnoiseContext->m_output.c_texture_Texture_endingState;
-                            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-                            cmdList->ResourceBarrier(1, &barrier);
+                            run->m_texture.AdoptResource(fastnoiseContext->m_output.texture_Texture, fastnoiseContext->m_input.variable_TextureSize[0], fastnoiseContext->m_input.variable_TextureSize[1] * fastnoiseContext->m_input.variable_TextureSize[2], 4, DXGI_FORMAT_R32G32B32A32_FLOAT, sizeof(float));
+                            run->m_data.AdoptResource(fastnoiseContext->m_output.buffer_Data, fastnoiseContext->m_output.buffer_Data_count);
                         }
-                    }
 
-                    if (readbackBuffer)
-                    {
-                        if (fastnoiseContext->m_output.c_buffer_Data_endingState != D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+                        if (readbackImage)
                         {
-                            D3D12_RESOURCE_BARRIER barrier;
-                            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-                            barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-                            barrier.Transition.pResource = fastnoiseContext->m_output.buffer_Data;
-                            barrier.Transition.StateBefore = fastnoiseContext->m_output.c_buffer_Data_endingState;
-                            barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-                            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-                            cmdList->ResourceBarrier(1, &barrier);
+                            TransitionResource(cmdList, fastnoiseContext->m_output.texture_Texture, fastnoiseContext->m_output.c_texture_Texture_endingState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                            run->m_texture.RequestReadback(device, cmdList);
+                            TransitionResource(cmdList, fastnoiseContext->m_output.texture_Texture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, fastnoiseContext->m_output.c_texture_Texture_endingState);
                         }
 
-                        fastnoiseData.RequestReadback(device, cmdList);
-
-                        if (fastnoiseContext->m_output.c_buffer_Data_endingState != D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+                        if (readbackData)
                         {
-                            D3D12_RESOURCE_BARRIER barrier;
-                            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-                            barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-                            barrier.Transition.pResource = fastnoiseContext->m_output.buffer_Data;
-                            barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-                            barrier.Transition.StateAfter = fastnoiseContext->m_output.c_buffer_Data_endingState;
-                            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-                            cmdList->ResourceBarrier(1, &barrier);
+                            TransitionResource(cmdList, fastnoiseContext->m_output.buffer_Data, fastnoiseContext->m_output.c_buffer_Data_endingState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                            run->m_data.RequestReadback(device, cmdList);
+                            TransitionResource(cmdList, fastnoiseContext->m_output.buffer_Data, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, fastnoiseContext->m_output.c_buffer_Data_endingState);
                         }
                     }
                 }
             );
+            executeScope.End();
+
+            // The GPU passes, from the timestamps the technique records when profiling. The GPU's clock isn't the CPU's,
+            // so the runs' passes are laid end to end, finishing when Execute() returned after waiting for the GPU.
+            if (Trace::IsEnabled())
+            {
+                double gpuEnd = Trace::Now();
+                double gpuStart = gpuEnd;
+                for (std::unique_ptr<Run>& run : runs)
+                {
+                    int numItems = 0;
+                    const fastnoise::ProfileEntry* items = run->m_context->ReadbackProfileData(dx12.m_commandQueue, numItems);
+                    if (numItems > 0)
+                        gpuStart -= double(items[numItems - 1].m_gpu) * 1000000.0;
+                }
+
+                for (std::unique_ptr<Run>& run : runs)
+                {
+                    int numItems = 0;
+                    const fastnoise::ProfileEntry* items = run->m_context->ReadbackProfileData(dx12.m_commandQueue, numItems);
+                    if (numItems == 0)
+                        continue;
+
+                    // The last item is the total, which includes the barriers between the passes
+                    double passStart = gpuStart;
+                    for (int i = 0; i < numItems - 1; ++i)
+                    {
+                        Trace::AddSpan(items[i].m_label, "gpu", passStart, double(items[i].m_gpu) * 1000000.0, Trace::c_gpuThread, step);
+                        passStart += double(items[i].m_gpu) * 1000000.0;
+                    }
+                    gpuStart += double(items[numItems - 1].m_gpu) * 1000000.0;
+                }
+            }
 
             if (readbackImage)
             {
+                Trace::Scope scope("readback", "cpu", step);
+                for (std::unique_ptr<Run>& run : runs)
+                    run->m_texture.DoReadback();
+            }
+
+            // With several runs, the output is the one with the lowest energy
+            if ((exchange || halve || lastStep) && runs.size() > 1)
+            {
+                Trace::Scope scope("energy", "cpu", step);
+                for (std::unique_ptr<Run>& run : runs)
+                    run->m_energy = CalculateEnergy(settings, filterBuffer.m_data, (const float*)run->m_texture.m_pixels.data(), &outputQueue.GetThreadPool());
+            }
+
+            // Parallel tempering: offer to exchange the temperatures of neighbouring replicas, which is the same as exchanging
+            // their states. Alternate between the even and odd neighbours so every pair gets a chance.
+            if (exchange)
+            {
+                std::vector<Run*> byTemperature(runs.size());
+                for (std::unique_ptr<Run>& run : runs)
+                    byTemperature[run->m_temperatureIndex] = run.get();
+
+                // The energy is per pixel and counts each pair of pixels twice, while the temperature applies to the loss of a single swap
+                const double c_energyScale = 0.5 * double(settings.variable_TextureSize[0]) * double(settings.variable_TextureSize[1]) * double(settings.variable_TextureSize[2]);
+
+                std::uniform_real_distribution<double> dist01(0.0, 1.0);
+                for (size_t index = (step / c_exchangeInterval) % 2; index + 1 < byTemperature.size(); index += 2)
+                {
+                    Run* colder = byTemperature[index];
+                    Run* hotter = byTemperature[index + 1];
+                    double logAcceptance = (1.0 / colder->m_temperature - 1.0 / hotter->m_temperature) * (colder->m_energy - hotter->m_energy) * c_energyScale;
+
+                    exchangesAttempted++;
+                    if (logAcceptance >= 0.0 || dist01(exchangeRNG) < std::exp(logAcceptance))
+                    {
+                        std::swap(colder->m_temperature, hotter->m_temperature);
+                        std::swap(colder->m_temperatureIndex, hotter->m_temperatureIndex);
+                        exchangesAccepted++;
+                    }
+                }
+            }
+
+            if (halve)
+            {
+                std::sort(runs.begin(), runs.end(),
+                    [](const std::unique_ptr<Run>& A, const std::unique_ptr<Run>& B)
+                    {
+                        return A->m_energy < B->m_energy;
+                    }
+                );
+                runs.resize((runs.size() + 1) / 2);
+                halvingRound++;
+                printf("Halving: %i runs left, best energy = %f\n", (int)runs.size(), runs[0]->m_energy);
+            }
+
+            // The run that progress images and status come from: the coldest one while going, the best one at the end
+            Run* outputRun = runs[0].get();
+            for (std::unique_ptr<Run>& run : runs)
+            {
+                if (lastStep ? (run->m_energy < outputRun->m_energy) : (run->m_temperatureIndex < outputRun->m_temperatureIndex))
+                    outputRun = run.get();
+            }
+            fastnoise::Context* fastnoiseContext = outputRun->m_context;
+
+            if (saveImage)
+            {
+                // Waits for room in the output queue and copies the pixels, the rest happens on the queue's threads
+                Trace::Scope scope("queue", "cpu", step);
+
                 char fileName[256];
-                fastnoiseTexture.DoReadback();
+                SImage& fastnoiseTexture = outputRun->m_texture;
 
                 //g_outputLayersAsSingleImages
 
@@ -928,63 +1529,160 @@ int main(int argc, char** argv)
                     pixelConversion = SImage::PixelConversions::PixelsAreF32_SaveAsF32;
                 }
 
-                if (g_outputLayersAsSingleImages && fastnoiseContext->m_input.variable_TextureSize[2] > 1)
+                if (lastStep && g_volumeOutput)
+                {
+                    sprintf_s(fileName, "%s.%s", g_outputFileName.c_str(), (g_volumeContainer == VolumeTexture::Container::DDS) ? "dds" : "ktx2");
+                    outputQueue.SaveVolume(fastnoiseTexture, fileName, fastnoiseContext->m_input.variable_TextureSize[2], g_volumeContainer, g_volumeFormat);
+                }
+                else if (g_outputLayersAsSingleImages && g_exrParts && g_outputType == OutputType::EXR && fastnoiseContext->m_input.variable_TextureSize[2] > 1)
+                {
+                    if (lastStep)
+                        sprintf_s(fileName, "%s.%s", g_outputFileName.c_str(), extension);
+                    else
+                        sprintf_s(fileName, "%s.%i.%s", g_outputFileName.c_str(), step, extension);
+                    outputQueue.SaveEXRParts(fastnoiseTexture, fileName, fastnoiseContext->m_input.variable_TextureSize[1]);
+                }
+                else if (g_outputLayersAsSingleImages && fastnoiseContext->m_input.variable_TextureSize[2] > 1)
                 {
+                    std::vector<std::string> fileNames;
                     for (unsigned int z = 0; z < fastnoiseContext->m_input.variable_TextureSize[2]; ++z)
                     {
-                        if (step == (g_numSteps - 1))
+                        if (lastStep)
                             sprintf_s(fileName, "%s_%i.%s", g_outputFileName.c_str(), z, extension);
                         else
                             sprintf_s(fileName, "%s_%i.%i.%s", g_outputFileName.c_str(), z, step, extension);
-
-                        fastnoiseTexture.SaveRegion(fileName, 0, fastnoiseContext->m_input.variable_TextureSize[0], z * fastnoiseContext->m_input.variable_TextureSize[1], (z + 1) * fastnoiseContext->m_input.variable_TextureSize[1], pixelConversion);
+                        fileNames.push_back(fileName);
                     }
+
+                    outputQueue.SaveSlices(fastnoiseTexture, fileNames, fastnoiseContext->m_input.variable_TextureSize[1], pixelConversion);
                 }
                 else
                 {
-                    if (step == (g_numSteps - 1))
+                    if (lastStep)
                         sprintf_s(fileName, "%s.%s", g_outputFileName.c_str(), extension);
                     else
                         sprintf_s(fileName, "%s.%i.%s", g_outputFileName.c_str(), step, extension);
-                    fastnoiseTexture.Save(fileName, pixelConversion);
+                    outputQueue.Save(fastnoiseTexture, fileName, pixelConversion);
                 }
             }
 
-            if (readbackBuffer)
+            if (readbackData)
             {
-                fastnoiseData.DoReadback();
-                float percent = 100.0f * float(step) / float(g_numSteps - 1);
-                printf("\r%0.2f%%  iterations = %i, swaps = %i, suppression = %i\n", percent, step, fastnoiseData.m_data[0].swaps, fastnoiseContext->m_input.variable_swapSuppression);
+                Trace::Scope scope("readback", "cpu", step);
+                for (std::unique_ptr<Run>& run : runs)
+                    run->m_data.DoReadback();
+            }
 
-                char buffer[1024];
-                sprintf_s(buffer, "%s [%i%%]", g_outputFileName.c_str(), int(percent));
-                SetConsoleTitleA(buffer);
+            // Before the status report, which can change the swap suppression this step ran with
+            if (measure)
+            {
+                Trace::Scope scope("metrics", "cpu", step);
+                std::chrono::high_resolution_clock::time_point measureStart = std::chrono::high_resolution_clock::now();
 
-                // Dynamic swap suppression. If the number of swaps is lower than expected we can reduce the suppression rate.
-                if (fastnoiseContext->m_input.variable_swapSuppression > 1)
+                const fastnoise::Struct_DataStruct& data = outputRun->m_data.m_data[0];
+                const fastnoise::Context::ContextInput& input = fastnoiseContext->m_input;
+                NoiseMetrics noiseMetrics = CalculateMetrics(input, filterBuffer.m_data, (const float*)outputRun->m_texture.m_pixels.data(), g_seed, &outputQueue.GetThreadPool());
+
+                // Swap suppression lets only 1 in swapSuppression of the pairs attempt a swap
+                double pairs = 0.5 * double(input.variable_TextureSize[0]) * double(input.variable_TextureSize[1]) * double(input.variable_TextureSize[2]);
+                double attempts = pairs / double(input.variable_swapSuppression);
+                double acceptanceRate = (attempts > 0.0) ? std::min(double(data.swaps) / attempts, 1.0) : 0.0;
+
+                double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(measureStart - startTime).count() - metricsSeconds;
+                fprintf(metricsFile, "{\"step\": %i, \"seconds\": %f, \"filteredErrorRMS\": %.9g, \"lowFrequencyPower\": %.9g, \"acceptanceRate\": %.9g, \"swaps\": %u, \"candidates\": %u, \"swapSuppression\": %u, \"temperature\": %g}\n",
+                    step, seconds, noiseMetrics.filteredErrorRMS, noiseMetrics.lowFrequencyPower, acceptanceRate, data.swaps, data.candidates, input.variable_swapSuppression, outputRun->m_temperature);
+                fflush(metricsFile);
+
+                metricsSeconds += std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - measureStart).count();
+            }
+
+            if (readbackBuffer)
+            {
+                Trace::Scope scope("status", "cpu", step);
+                for (std::unique_ptr<Run>& run : runs)
                 {
-                    unsigned int pixels = fastnoiseContext->m_input.variable_TextureSize[0] * fastnoiseContext->m_input.variable_TextureSize[1] * fastnoiseContext->m_input.variable_TextureSize[2];
-                    if (8 * fastnoiseData.m_data[0].swaps * fastnoiseContext->m_input.variable_swapSuppression < pixels)
+                    const fastnoise::Struct_DataStruct& data = run->m_data.m_data[0];
+                    fastnoise::Context::ContextInput& input = run->m_context->m_input;
+
+                    // Each pixel is in one pair, and pairs that aren't candidates would raise (or not change) the loss
+                    {
+                        unsigned int pairs = input.variable_TextureSize[0] * input.variable_TextureSize[1] * input.variable_TextureSize[2] / 2;
+                        unsigned int uphillProposals = pairs - std::min(pairs, data.candidates);
+                        run->m_annealing.Update(progress, uphillProposals, data.uphillSwaps, input.variable_swapSuppression);
+                    }
+
+                    // Dynamic swap suppression. If the number of swaps is lower than expected we can reduce the suppression rate.
+                    if (input.variable_swapSuppression > 1)
                     {
-                        fastnoiseContext->m_input.variable_swapSuppression /= 2;
+                        unsigned int pixels = input.variable_TextureSize[0] * input.variable_TextureSize[1] * input.variable_TextureSize[2];
+                        if (8 * data.swaps * input.variable_swapSuppression < pixels)
+                        {
+                            input.variable_swapSuppression /= 2;
+                        }
                     }
                 }
 
+                const fastnoise::Struct_DataStruct& data = outputRun->m_data.m_data[0];
+                float percent = 100.0f * progress;
+                float acceptedLoss;
+                memcpy(&acceptedLoss, &data.acceptedLoss, sizeof(float));
+                printf("\r%0.2f%%  iterations = %i, swaps = %i of %i, loss delta = %f, suppression = %i", percent, step, data.swaps, data.candidates, acceptedLoss, fastnoiseContext->m_input.variable_swapSuppression);
+                if (outputRun->m_temperature > 0.0f)
+                    printf(", temperature = %f, uphill swaps = %i", outputRun->m_temperature, data.uphillSwaps);
+                if (exchangesAttempted > 0)
+                    printf(", exchanges = %zu of %zu", exchangesAccepted, exchangesAttempted);
+                printf("\n");
+
+                char buffer[1024];
+                sprintf_s(buffer, "%s [%i%%]", g_outputFileName.c_str(), int(percent));
+                SetConsoleTitleA(buffer);
+            }
+
+            if (lastStep && runs.size() > 1 && g_replicas.m_count > 0)
+            {
+                printf("\nBest replica: temperature = %f, energy = %f\n", outputRun->m_temperature, outputRun->m_energy);
+                for (std::unique_ptr<Run>& run : runs)
+                    printf("  temperature = %f, energy = %f\n", run->m_temperature, run->m_energy);
+            }
+
+            if (lastStep && g_restarts > 0)
+            {
+                if (runs.size() == 1)
+                    outputRun->m_energy = CalculateEnergy(settings, filterBuffer.m_data, (const float*)outputRun->m_texture.m_pixels.data(), &outputQueue.GetThreadPool());
+
+                printf("\nBest seed: %u, energy = %f\n", outputRun->m_seed, outputRun->m_energy);
+                for (std::unique_ptr<Run>& run : runs)
+                    printf("  seed = %u, energy = %f\n", run->m_seed, run->m_energy);
+                SaveSeedFile(outputRun->m_seed, outputRun->m_energy, argc, argv);
             }
 
-            // This is how you'd get or print out cpu and gpu profiling info if you want it.
-            // You would need to set fastnoiseContext->m_profile to true though when you create the context, instead of false.
-            /*
-            int numItems = 0;
-            auto* items = fastnoiseContext->ReadbackProfileData(dx12.m_commandQueue, numItems);
-            for (int i = 0; i < numItems; ++i)
-                printf("fastnoise::%s\tcpu=%0.2fms\tgpu=%0.2fms\n", items[i].m_label, items[i].m_cpu * 1000.0f, items[i].m_gpu * 1000.0f);
-            */
+            if (lastStep && g_calculateEnergy)
+            {
+                if (runs.size() == 1 && g_restarts == 0)
+                    outputRun->m_energy = CalculateEnergy(settings, filterBuffer.m_data, (const float*)outputRun->m_texture.m_pixels.data(), &outputQueue.GetThreadPool());
+                printf("\nenergy = %f\n", outputRun->m_energy);
+            }
         }
+
+        // Wait for the images still being written
+        {
+            Trace::Scope scope("flush");
+            outputQueue.Flush();
+        }
+
+        if (metricsFile)
+            fclose(metricsFile);
+    }
+
+    if (g_traceFile)
+    {
+        if (!Trace::Save(g_traceFile))
+            printf("[Error] Could not open file for writing \"%s\".\n", g_traceFile);
+        Trace::PrintSummary();
     }
 
     // Shutdown
-    fastnoise::DestroyContext(fastnoiseContext);
+    runs.clear();
     printf("\n\n");
 
     return 0;
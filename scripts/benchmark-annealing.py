@@ -0,0 +1,70 @@
+#///////////////////////////////////////////////////////////////////////////////
+#//               FastNoise - F.A.S.T. Sampling Implementation                //
+#//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+#///////////////////////////////////////////////////////////////////////////////
+
+# Compares the energy (loss per pixel, lower is better) that the greedy optimization and the annealing schedules
+# reach within the same time budget. Run from the root of the repo, next to FastNoise.exe.
+
+import os.path
+import re
+import subprocess
+import sys
+
+timeLimit = float(sys.argv[1]) if len(sys.argv) > 1 else 30.0
+seeds = [1, 2, 3]
+
+configs = [
+    ("gauss1", "real uniform gauss 1.0 box 1 product 128 128 1"),
+    ("gauss2", "real uniform gauss 2.0 box 1 product 128 128 1"),
+    ("vector2_binomial2", "vector2 uniform binomial 2 box 1 product 128 128 1"),
+    ("gauss1_exponential", "real uniform gauss 1.0 exponential 0.1 0.1 separate 0.5 128 128 32"),
+]
+
+schedules = [
+    ("greedy", ""),
+    ("geometric", "-anneal geometric 0.01 0.0001"),
+    ("adaptive", "-anneal adaptive 0.01 0.2"),
+]
+
+os.makedirs("analysis/benchmark-annealing", exist_ok = True)
+
+results = {}
+with open("analysis/benchmark-annealing/results.csv", "w") as csv:
+    csv.write("config,schedule,seed,energy\n")
+    for (configName, config) in configs:
+        for (scheduleName, schedule) in schedules:
+            for seed in seeds:
+                filename = f"analysis/benchmark-annealing/{configName}_{scheduleName}_{seed}"
+                cmd = f"FastNoise.exe {config} {filename} -seed {seed} -numsteps 100000000 -timelimit {timeLimit} -energy {schedule}"
+                print(cmd)
+                output = subprocess.run(cmd, shell = True, capture_output = True, text = True).stdout
+
+                match = re.search(r"energy = (\S+)", output)
+                if not match:
+                    print("  no energy reported")
+                    continue
+
+                energy = float(match.group(1))
+                print(f"  energy = {energy}")
+                csv.write(f"{configName},{scheduleName},{seed},{energy}\n")
+                results.setdefault((configName, scheduleName), []).append(energy)
+
+# Mean energy per config and schedule, and the difference from greedy
+print(f"\nMean energy after {timeLimit} seconds:\n")
+print(f"{'config':<24}" + "".join(f"{scheduleName:>24}" for (scheduleName, schedule) in schedules))
+for (configName, config) in configs:
+    greedy = results.get((configName, "greedy"))
+    greedyMean = sum(greedy) / len(greedy) if greedy else None
+    line = f"{configName:<24}"
+    for (scheduleName, schedule) in schedules:
+        energies = results.get((configName, scheduleName))
+        if not energies:
+            line += f"{'-':>24}"
+            continue
+        mean = sum(energies) / len(energies)
+        if greedyMean is not None and scheduleName != "greedy":
+            line += f"{f'{mean:.6f} ({mean - greedyMean:+.6f})':>24}"
+        else:
+            line += f"{mean:>24.6f}"
+    print(line)
@@ -7,7 +7,7 @@ import sys
 
 import matplotlib.pyplot as plt
 import numpy as np
-from matplotlib import image
+from PIL import Image
 import imageio
 
 # imageio is for hdr support.
@@ -27,7 +27,12 @@ if isHDR:
     img = imageio.v2.imread(sys.argv[1], format='HDR-FI')
     sys.argv[1] = sys.argv[1].replace(".hdr", ".png")
 else:
-    img = image.imread(sys.argv[1])
+    # Load PNGs with the channels they are stored with. matplotlib's imread would expand vector2's grey+alpha to RGBA.
+    img = np.asarray(Image.open(sys.argv[1])) / 255.0
+
+# Single channel images load without a channel axis
+if img.ndim == 2:
+    img = img[:, :, np.newaxis]
 
 
 if sys.argv[2] == "circle" or sys.argv[2] == "real":
@@ -7,10 +7,21 @@ import os.path
 
 computeHistogram = True
 computeSpectrum = True
+validateDistribution = True
 
 width=128
 height=128
 
+# The native spectrum tool, built by FastNoise.sln. scripts/spectrum.py gives the same analysis, but takes minutes per texture.
+spectrumTool = os.path.join("tools", "fastnoise-spectrum", "fastnoise-spectrum.exe")
+
+# Checks each texture still has its init distribution, and returns nonzero if not. Results for all textures go in one CSV.
+histogramTool = os.path.join("tools", "fastnoise-histogram", "fastnoise-histogram.exe")
+distributionSummary = "analysis/distribution.csv"
+failed = []
+if validateDistribution and os.path.isfile(distributionSummary):
+    os.remove(distributionSummary)
+
 # Generate sample textures, together with histograms and noise spectrum
 for (space, distribution) in [("real", "uniform"), ("real", "tent"), ("circle", "uniform"), ("vector2", "uniform"), ("sphere", "uniform"), ("sphere", "cosine"), ("vector3", "uniform"), ("vector4", "uniform")]:
     for (filter, param) in [("box", 3), ("box", 5), ("binomial", 2), ("binomial", 3), ("gauss", 0.7), ("gauss", 1.0)]:
@@ -29,6 +40,18 @@ for (space, distribution) in [("real", "uniform"), ("real", "tent"), ("circle",
             os.system(cmd)
             
         if computeSpectrum and not os.path.isfile(filename + "_spectrum.png"):
-            cmd = f"python scripts/spectrum.py {filename}.png {space}"
+            cmd = f"{spectrumTool} {filename}.png {space}"
+            print(cmd)
+            os.system(cmd)
+
+        if validateDistribution:
+            cmd = f"{histogramTool} {filename}.png {space} {distribution} -summary {distributionSummary}"
             print(cmd)
-            os.system(cmd)
\ No newline at end of file
+            if os.system(cmd) != 0:
+                failed.append(filename)
+
+if failed:
+    print(f"{len(failed)} textures failed distribution validation:")
+    for filename in failed:
+        print(f"  {filename}")
+    exit(1)
\ No newline at end of file
@@ -12,6 +12,10 @@ width=128
 height=128
 depth=64
 
+# The native analysis tools, built by FastNoise.sln. scripts/spectrum.py and scripts/temporal.py do the same, much more slowly.
+spectrumTool = os.path.join("tools", "fastnoise-spectrum", "fastnoise-spectrum.exe")
+temporalTool = os.path.join("tools", "fastnoise-temporal", "fastnoise-temporal.exe")
+
 # Temporal comparison with STBN
 for (space,distribution) in [("real", "uniform")]:
     for (filter,param) in [("gauss", 1.3435)]:
@@ -49,12 +53,12 @@ for (space,distribution) in [("real", "uniform")]:
                             os.system(cmd)
 
                         if computeSpectrum and not os.path.isfile(filename + "_spectrum.png"):
-                            cmd = f"python scripts/spectrum.py {filename}.png {space}"
+                            cmd = f"{spectrumTool} {filename}.png {space}"
                             print(cmd)
                             os.system(cmd)                
 
                         if not os.path.isfile(filename + "_temporal.csv"):
-                            cmd = f"python scripts/temporal.py {filename}.png {space} {filter} {param} {filterAlpha}"
+                            cmd = f"{temporalTool} {filename}.png {space} {filter} {param} {filterAlpha}"
                             print(cmd)
                             os.system(cmd)                
 
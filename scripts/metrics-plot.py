@@ -0,0 +1,47 @@
+#///////////////////////////////////////////////////////////////////////////////
+#//               FastNoise - F.A.S.T. Sampling Implementation                //
+#//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+#///////////////////////////////////////////////////////////////////////////////
+
+# Plots the .metrics.jsonl files that FastNoise.exe -metrics writes, and prints the first step at which the filtered
+# error is within a tolerance of where it ends up, which is about as many steps as that configuration needs.
+
+import json
+import sys
+
+import matplotlib.pyplot as plt
+
+if len(sys.argv) < 3:
+    print(f"Usage: {sys.argv[0]} output.png file.metrics.jsonl [file.metrics.jsonl ...]")
+    exit(1)
+
+tolerance = 0.01
+
+fig, axs = plt.subplots(1, 3, figsize=(18, 5))
+axs[0].set_ylabel("Filtered error RMS")
+axs[1].set_ylabel("Low frequency power")
+axs[2].set_ylabel("Acceptance rate")
+for ax in axs:
+    ax.set_xlabel("Step")
+    ax.set_xscale("symlog")
+
+for fn in sys.argv[2:]:
+    with open(fn) as f:
+        lines = [json.loads(line) for line in f if line.strip()]
+    if not lines:
+        continue
+
+    steps = [line["step"] for line in lines]
+    error = [line["filteredErrorRMS"] for line in lines]
+    axs[0].plot(steps, error, label = fn)
+    axs[1].plot(steps, [line["lowFrequencyPower"] for line in lines], label = fn)
+    axs[2].plot(steps, [line["acceptanceRate"] for line in lines], label = fn)
+
+    final = error[-1]
+    converged = next(line for line in lines if line["filteredErrorRMS"] <= final * (1.0 + tolerance))
+    print(f"{fn}: within {tolerance * 100:g}% of the final filtered error at step {converged['step']} ({converged['seconds']:.2f}s) of {steps[-1]}")
+
+axs[0].set_yscale("log")
+axs[2].set_yscale("log")
+lgd = axs[2].legend(loc='center left', bbox_to_anchor=(1, 0.5))
+plt.savefig(sys.argv[1], bbox_extra_artists=(lgd,), bbox_inches='tight')
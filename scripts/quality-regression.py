@@ -0,0 +1,148 @@
+#///////////////////////////////////////////////////////////////////////////////
+#//               FastNoise - F.A.S.T. Sampling Implementation                //
+#//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+#///////////////////////////////////////////////////////////////////////////////
+
+# Checks that a change made for speed didn't make the noise worse. Each config runs for the same wall clock time with a
+# fixed seed, and its filtered error curve (from -metrics) and final energy are compared with golden ones saved by an
+# earlier run with --update. A change that speeds the optimizer up should be at or below the golden curve. Configs run
+# in parallel, --jobs at a time.
+#
+# The curves depend on the machine, the time budget and the number of jobs, so the golden file records the budget and jobs
+# and is only compared against runs with the same ones. --warp runs FastNoise.exe on D3D12's software rasterizer, for
+# machines without a GPU. Returns 1 if any config is worse than its golden curve by more than the tolerance.
+#
+# Run from the root of the repo, next to FastNoise.exe:
+#   python scripts/quality-regression.py [--update] [--warp] [--jobs <count>] [--seconds <budget>]
+
+import concurrent.futures
+import json
+import os
+import re
+import subprocess
+import sys
+
+seed = 5489
+metricsInterval = 50
+
+# How much higher than golden the filtered error and the energy can be
+errorTolerance = 0.05
+energyTolerance = 0.02
+
+# Where along the time budget the filtered error curves are compared
+checkpoints = [0.25, 0.5, 1.0]
+
+configs = [
+    ("real_box3", "real uniform box 3 box 1 product 64 64 1"),
+    ("real_gauss1", "real uniform gauss 1.0 box 1 product 64 64 1"),
+    ("circle_binomial2", "circle uniform binomial 2 box 1 product 64 64 1"),
+    ("vector2_gauss1", "vector2 uniform gauss 1.0 box 1 product 64 64 1"),
+    ("sphere_box3", "sphere uniform box 3 box 1 product 64 64 1"),
+    ("real_gauss1_exponential_separate", "real uniform gauss 1.0 exponential 0.1 0.1 separate 0.5 32 32 16"),
+    ("vector2_box3_gauss1_product", "vector2 uniform box 3 gauss 1.0 product 32 32 16"),
+]
+
+update = "--update" in sys.argv
+warp = "--warp" in sys.argv
+jobs = int(sys.argv[sys.argv.index("--jobs") + 1]) if "--jobs" in sys.argv else 4
+seconds = float(sys.argv[sys.argv.index("--seconds") + 1]) if "--seconds" in sys.argv else 20.0
+
+folder = "analysis/quality-regression"
+goldenFileName = f"{folder}/golden.json"
+os.makedirs(folder, exist_ok = True)
+
+def Run(configName, config):
+    filename = f"{folder}/{configName}"
+    if os.path.isfile(filename + ".metrics.jsonl"):
+        os.remove(filename + ".metrics.jsonl")
+
+    cmd = f"FastNoise.exe {config} {filename} -seed {seed} -numsteps 100000000 -timelimit {seconds} -metrics {metricsInterval} -energy"
+    if warp:
+        cmd += " -warp"
+    output = subprocess.run(cmd, shell = True, capture_output = True, text = True).stdout
+
+    match = re.search(r"^energy = (\S+)", output, re.MULTILINE)
+    if not match or not os.path.isfile(filename + ".metrics.jsonl"):
+        return None
+
+    with open(filename + ".metrics.jsonl") as f:
+        lines = [json.loads(line) for line in f if line.strip()]
+    if not lines:
+        return None
+
+    return {
+        "energy": float(match.group(1)),
+        "steps": lines[-1]["step"],
+        "curve": [[line["seconds"], line["filteredErrorRMS"]] for line in lines],
+    }
+
+# The filtered error at a time, linearly interpolated. Past the end of the curve it is the last value.
+def ErrorAt(curve, time):
+    if time <= curve[0][0]:
+        return curve[0][1]
+    for (a, b) in zip(curve, curve[1:]):
+        if time <= b[0]:
+            t = (time - a[0]) / (b[0] - a[0]) if b[0] > a[0] else 1.0
+            return a[1] + (b[1] - a[1]) * t
+    return curve[-1][1]
+
+golden = None
+if not update:
+    if not os.path.isfile(goldenFileName):
+        print(f"No golden curves in {goldenFileName}. Run with --update to make them.")
+        exit(1)
+    with open(goldenFileName) as f:
+        golden = json.load(f)
+    if golden["seconds"] != seconds or golden["jobs"] != jobs or golden["warp"] != warp:
+        print(f"The golden curves were made with --seconds {golden['seconds']} --jobs {golden['jobs']}{' --warp' if golden['warp'] else ''}. Run with those, or --update.")
+        exit(1)
+
+print(f"Running {len(configs)} configs for {seconds} seconds each, {jobs} at a time")
+with concurrent.futures.ThreadPoolExecutor(max_workers = jobs) as executor:
+    futures = {configName: executor.submit(Run, configName, config) for (configName, config) in configs}
+    results = {configName: future.result() for (configName, future) in futures.items()}
+
+failed = []
+for (configName, config) in configs:
+    result = results[configName]
+    if result is None:
+        print(f"{configName}: FastNoise.exe failed")
+        failed.append(configName)
+        continue
+
+    print(f"{configName}: {result['steps']} steps, energy = {result['energy']:.6f}, filtered error = {result['curve'][-1][1]:.6f}")
+    if golden is None:
+        continue
+
+    expected = golden["configs"].get(configName)
+    if expected is None:
+        print("  no golden curve")
+        continue
+
+    worse = []
+    for checkpoint in checkpoints:
+        time = checkpoint * seconds
+        error = ErrorAt(result["curve"], time)
+        goldenError = ErrorAt(expected["curve"], time)
+        change = error / goldenError - 1.0
+        print(f"  filtered error at {time:g}s: {error:.6f}, golden {goldenError:.6f} ({change * 100:+.1f}%)")
+        if change > errorTolerance:
+            worse.append(f"filtered error at {time:g}s")
+
+    change = result["energy"] / expected["energy"] - 1.0
+    print(f"  energy: {result['energy']:.6f}, golden {expected['energy']:.6f} ({change * 100:+.1f}%)")
+    if change > energyTolerance:
+        worse.append("energy")
+
+    if worse:
+        print(f"  WORSE: {', '.join(worse)}")
+        failed.append(configName)
+
+if update:
+    with open(goldenFileName, "w") as f:
+        json.dump({"seconds": seconds, "jobs": jobs, "warp": warp, "configs": {name: result for (name, result) in results.items() if result is not None}}, f, indent = 1)
+    print(f"Golden curves written to {goldenFileName}")
+
+if failed:
+    print(f"\n{len(failed)} of {len(configs)} configs failed: {', '.join(failed)}")
+    exit(1)
@@ -6,9 +6,12 @@
 import sys
 import numpy as np
 from matplotlib import image
+from PIL import Image
 from numpy import pi, sin, cos, modf, sqrt
 import imageio
 
+# tools/fastnoise-spectrum is a native version of this script that is much faster, and also writes a radially averaged CSV.
+
 # imageio is for hdr support.
 # https://matiascodesal.com/blog/how-read-hdr-image-using-python/
 
@@ -30,7 +33,12 @@ if isHDR:
     imageio.plugins.freeimage.download()
     img = imageio.v2.imread(filename, format='HDR-FI')
 else:
-    img = image.imread(filename)
+    # Load PNGs with the channels they are stored with. matplotlib's imread would expand vector2's grey+alpha to RGBA.
+    img = np.asarray(Image.open(filename)) / 255.0
+
+# Single channel images load without a channel axis
+if img.ndim == 2:
+    img = img[:, :, np.newaxis]
 
 # Interpret 2D image as a stack of square images
 inputShape = img.shape
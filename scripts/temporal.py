@@ -5,9 +5,11 @@
 
 import sys
 import numpy as np
-from matplotlib import image
+from PIL import Image
 from numpy import pi, sin, cos, modf, sqrt
 
+# tools/fastnoise-temporal is a native version of this script that is much faster, and writes the same CSV.
+
 # TODO: Allow for any spatial filter (box, gauss, binomial)
 # Binomial can be hand-coded or iterated uniform filter
 from scipy.ndimage.filters import gaussian_filter, uniform_filter
@@ -29,7 +31,12 @@ alpha = float(sys.argv[5])
 
 numSamples = 256
 
-img = image.imread(filename)
+# Load PNGs with the channels they are stored with. matplotlib's imread would expand vector2's grey+alpha to RGBA.
+img = np.asarray(Image.open(filename)) / 255.0
+
+# Single channel images load without a channel axis
+if img.ndim == 2:
+    img = img[:, :, np.newaxis]
 
 # Map from [0,1] into [-1,1]
 img = (img - 0.5) * 2.0 * 255.0 / 256.0
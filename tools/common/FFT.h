@@ -0,0 +1,350 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "../../ThreadPool.h"
+#include <emmintrin.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+// Forward FFTs of any length, e^(-2 pi i jk/n) and unnormalized like numpy's fftn.
+//
+// Transforms are done four at a time, one per SSE lane, so every butterfly is plain SIMD math with no shuffles.
+// Each pass is a Stockham autosort stage, which ping pongs between two buffers and leaves the result in natural
+// order without a bit reversal pass. The length is factored into radix 4, 2, 3 and 5 stages, and any other prime
+// factor gets a direct DFT stage, so lengths that aren't powers of two work, just slower.
+namespace FFT
+{
+    struct Complex4
+    {
+        __m128 re;
+        __m128 im;
+    };
+
+    inline Complex4 Add(const Complex4& a, const Complex4& b) { return { _mm_add_ps(a.re, b.re), _mm_add_ps(a.im, b.im) }; }
+    inline Complex4 Sub(const Complex4& a, const Complex4& b) { return { _mm_sub_ps(a.re, b.re), _mm_sub_ps(a.im, b.im) }; }
+    inline Complex4 Scale(const Complex4& a, __m128 s) { return { _mm_mul_ps(a.re, s), _mm_mul_ps(a.im, s) }; }
+
+    // a * (re + i im), for a twiddle that is the same in every lane
+    inline Complex4 Mul(const Complex4& a, __m128 re, __m128 im)
+    {
+        return { _mm_sub_ps(_mm_mul_ps(a.re, re), _mm_mul_ps(a.im, im)), _mm_add_ps(_mm_mul_ps(a.re, im), _mm_mul_ps(a.im, re)) };
+    }
+
+    // a * -i
+    inline Complex4 MulNegI(const Complex4& a) { return { a.im, _mm_sub_ps(_mm_setzero_ps(), a.re) }; }
+
+    class Plan
+    {
+    public:
+        explicit Plan(int size = 1)
+            : m_size(size)
+        {
+            // Radix 4 first, as it is the cheapest per element
+            std::vector<int> radices;
+            int remaining = size;
+            while (remaining % 4 == 0) { radices.push_back(4); remaining /= 4; }
+            while (remaining % 2 == 0) { radices.push_back(2); remaining /= 2; }
+            for (int factor = 3; remaining > 1; factor += 2)
+            {
+                while (remaining % factor == 0) { radices.push_back(factor); remaining /= factor; }
+            }
+
+            // Twiddles W_n^(u p) for p in [0, n / radix) and u in [1, radix)
+            int length = size;
+            int stride = 1;
+            for (int radix : radices)
+            {
+                Stage stage;
+                stage.radix = radix;
+                stage.length = length;
+                stage.stride = stride;
+                stage.twiddleOffset = m_twiddles.size();
+                for (int p = 0; p < length / radix; ++p)
+                {
+                    for (int u = 1; u < radix; ++u)
+                    {
+                        double angle = -2.0 * 3.14159265358979323846 * double(u) * double(p) / double(length);
+                        m_twiddles.push_back({ (float)cos(angle), (float)sin(angle) });
+                    }
+                }
+
+                // The direct DFT's roots W_radix^k
+                stage.rootOffset = m_roots.size();
+                if (radix > 5)
+                {
+                    for (int k = 0; k < radix; ++k)
+                    {
+                        double angle = -2.0 * 3.14159265358979323846 * double(k) / double(radix);
+                        m_roots.push_back({ (float)cos(angle), (float)sin(angle) });
+                    }
+                }
+
+                m_stages.push_back(stage);
+                length /= radix;
+                stride *= radix;
+            }
+        }
+
+        int GetSize() const { return m_size; }
+
+        // Transforms four sequences of GetSize() values in place. scratch is GetSize() values too.
+        void Forward(Complex4* data, Complex4* scratch) const
+        {
+            Complex4* x = data;
+            Complex4* y = scratch;
+            for (const Stage& stage : m_stages)
+            {
+                RunStage(stage, x, y);
+                std::swap(x, y);
+            }
+
+            if (x != data)
+                std::copy(x, x + m_size, data);
+        }
+
+    private:
+        struct Twiddle
+        {
+            float re;
+            float im;
+        };
+
+        struct Stage
+        {
+            int radix;
+            int length;     // Of the sub-transforms this stage splits
+            int stride;     // How many of them are interleaved
+            size_t twiddleOffset;
+            size_t rootOffset;
+        };
+
+        // y[q + s (r p + u)] = W_n^(u p) * sum over t of x[q + s (p + t m)] * W_r^(t u), with m = n / r
+        void RunStage(const Stage& stage, const Complex4* x, Complex4* y) const
+        {
+            const int r = stage.radix;
+            const int s = stage.stride;
+            const int m = stage.length / r;
+            const Twiddle* twiddles = &m_twiddles[stage.twiddleOffset];
+
+            // Large prime factors are rare enough to not mind the allocation
+            Complex4 smallIn[c_maxDirectRadix];
+            Complex4 smallOut[c_maxDirectRadix];
+            std::vector<Complex4> largeIn, largeOut;
+            Complex4* in = smallIn;
+            Complex4* out = smallOut;
+            if (r > c_maxDirectRadix)
+            {
+                largeIn.resize(r);
+                largeOut.resize(r);
+                in = largeIn.data();
+                out = largeOut.data();
+            }
+
+            for (int p = 0; p < m; ++p)
+            {
+                const Twiddle* w = &twiddles[size_t(p) * (r - 1)];
+                for (int q = 0; q < s; ++q)
+                {
+                    for (int t = 0; t < r; ++t)
+                        in[t] = x[q + s * (p + t * m)];
+
+                    Butterfly(stage, in, out);
+
+                    Complex4* dest = &y[q + s * r * p];
+                    dest[0] = out[0];
+                    for (int u = 1; u < r; ++u)
+                        dest[s * u] = (p == 0) ? out[u] : Mul(out[u], _mm_set1_ps(w[u - 1].re), _mm_set1_ps(w[u - 1].im));
+                }
+            }
+        }
+
+        void Butterfly(const Stage& stage, const Complex4* a, Complex4* out) const
+        {
+            switch (stage.radix)
+            {
+                case 2:
+                {
+                    out[0] = Add(a[0], a[1]);
+                    out[1] = Sub(a[0], a[1]);
+                    break;
+                }
+                case 3:
+                {
+                    // W_3 = c + i s
+                    const __m128 c = _mm_set1_ps(-0.5f);
+                    const __m128 s = _mm_set1_ps(-0.86602540378443864676f);
+                    Complex4 sum = Add(a[1], a[2]);
+                    Complex4 diff = Sub(a[1], a[2]);
+                    Complex4 mid = Add(a[0], Scale(sum, c));
+                    Complex4 rot = { _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), diff.im), s), _mm_mul_ps(diff.re, s) };
+                    out[0] = Add(a[0], sum);
+                    out[1] = Add(mid, rot);
+                    out[2] = Sub(mid, rot);
+                    break;
+                }
+                case 4:
+                {
+                    Complex4 t0 = Add(a[0], a[2]);
+                    Complex4 t1 = Sub(a[0], a[2]);
+                    Complex4 t2 = Add(a[1], a[3]);
+                    Complex4 t3 = MulNegI(Sub(a[1], a[3]));
+                    out[0] = Add(t0, t2);
+                    out[1] = Add(t1, t3);
+                    out[2] = Sub(t0, t2);
+                    out[3] = Sub(t1, t3);
+                    break;
+                }
+                case 5:
+                {
+                    // W_5^k = c_k + i s_k
+                    const __m128 c1 = _mm_set1_ps(0.30901699437494742410f);
+                    const __m128 c2 = _mm_set1_ps(-0.80901699437494742410f);
+                    const __m128 s1 = _mm_set1_ps(-0.95105651629515357212f);
+                    const __m128 s2 = _mm_set1_ps(-0.58778525229247312917f);
+                    Complex4 sum1 = Add(a[1], a[4]);
+                    Complex4 diff1 = Sub(a[1], a[4]);
+                    Complex4 sum2 = Add(a[2], a[3]);
+                    Complex4 diff2 = Sub(a[2], a[3]);
+                    Complex4 mid1 = Add(a[0], Add(Scale(sum1, c1), Scale(sum2, c2)));
+                    Complex4 mid2 = Add(a[0], Add(Scale(sum1, c2), Scale(sum2, c1)));
+                    // i * (s1 diff1 + s2 diff2) and i * (s2 diff1 - s1 diff2)
+                    __m128 re1 = _mm_add_ps(_mm_mul_ps(diff1.re, s1), _mm_mul_ps(diff2.re, s2));
+                    __m128 im1 = _mm_add_ps(_mm_mul_ps(diff1.im, s1), _mm_mul_ps(diff2.im, s2));
+                    __m128 re2 = _mm_sub_ps(_mm_mul_ps(diff1.re, s2), _mm_mul_ps(diff2.re, s1));
+                    __m128 im2 = _mm_sub_ps(_mm_mul_ps(diff1.im, s2), _mm_mul_ps(diff2.im, s1));
+                    Complex4 rot1 = { _mm_sub_ps(_mm_setzero_ps(), im1), re1 };
+                    Complex4 rot2 = { _mm_sub_ps(_mm_setzero_ps(), im2), re2 };
+                    out[0] = Add(a[0], Add(sum1, sum2));
+                    out[1] = Add(mid1, rot1);
+                    out[4] = Sub(mid1, rot1);
+                    out[2] = Add(mid2, rot2);
+                    out[3] = Sub(mid2, rot2);
+                    break;
+                }
+                default:
+                {
+                    const int r = stage.radix;
+                    const Twiddle* roots = &m_roots[stage.rootOffset];
+                    for (int u = 0; u < r; ++u)
+                    {
+                        Complex4 sum = a[0];
+                        for (int t = 1; t < r; ++t)
+                        {
+                            const Twiddle& root = roots[(size_t(t) * u) % r];
+                            sum = Add(sum, Mul(a[t], _mm_set1_ps(root.re), _mm_set1_ps(root.im)));
+                        }
+                        out[u] = sum;
+                    }
+                    break;
+                }
+            }
+        }
+
+        static const int c_maxDirectRadix = 16;
+
+        int m_size = 1;
+        std::vector<Stage> m_stages;
+        std::vector<Twiddle> m_twiddles;
+        std::vector<Twiddle> m_roots;
+    };
+
+    // The transform of a width x height x depth volume of complex values, x fastest, along every axis longer than 1.
+    // Lines are gathered four at a time into SIMD lanes, and groups of lines run in parallel on the thread pool if one is given.
+    class Plan3D
+    {
+    public:
+        Plan3D(int width, int height, int depth)
+            : m_dims{ width, height, depth }
+        {
+            for (int axis = 0; axis < 3; ++axis)
+                m_plans[axis] = Plan(m_dims[axis]);
+        }
+
+        void Forward(float* re, float* im, ThreadPool* threadPool) const
+        {
+            const size_t strides[3] = { 1, size_t(m_dims[0]), size_t(m_dims[0]) * m_dims[1] };
+            const size_t total = strides[2] * m_dims[2];
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const int length = m_dims[axis];
+                if (length < 2)
+                    continue;
+
+                // Line i starts at the i-th position with this axis' coordinate at 0. The lines are numbered x fastest,
+                // so for the y and z axes the four lanes of a group are usually neighbors in memory.
+                const size_t lineCount = total / length;
+                const size_t stride = strides[axis];
+                auto lineStart = [&](size_t line)
+                {
+                    size_t inner = line % stride;
+                    size_t outer = line / stride;
+                    return outer * stride * length + inner;
+                };
+
+                const int groupCount = int((lineCount + 3) / 4);
+                const int threadCount = threadPool ? threadPool->GetThreadCount() + 1 : 1;
+                std::vector<std::vector<Complex4>> scratch(threadCount);
+
+                auto transformGroup = [&](int group, int threadIndex)
+                {
+                    std::vector<Complex4>& buffer = scratch[threadIndex];
+                    buffer.resize(size_t(length) * 2);
+                    Complex4* data = buffer.data();
+
+                    size_t starts[4];
+                    int lanes = 0;
+                    for (; lanes < 4 && size_t(group) * 4 + lanes < lineCount; ++lanes)
+                        starts[lanes] = lineStart(size_t(group) * 4 + lanes);
+
+                    for (int i = 0; i < length; ++i)
+                    {
+                        alignas(16) float laneRe[4] = {};
+                        alignas(16) float laneIm[4] = {};
+                        for (int lane = 0; lane < lanes; ++lane)
+                        {
+                            laneRe[lane] = re[starts[lane] + i * stride];
+                            laneIm[lane] = im[starts[lane] + i * stride];
+                        }
+                        data[i].re = _mm_load_ps(laneRe);
+                        data[i].im = _mm_load_ps(laneIm);
+                    }
+
+                    m_plans[axis].Forward(data, data + length);
+
+                    for (int i = 0; i < length; ++i)
+                    {
+                        alignas(16) float laneRe[4];
+                        alignas(16) float laneIm[4];
+                        _mm_store_ps(laneRe, data[i].re);
+                        _mm_store_ps(laneIm, data[i].im);
+                        for (int lane = 0; lane < lanes; ++lane)
+                        {
+                            re[starts[lane] + i * stride] = laneRe[lane];
+                            im[starts[lane] + i * stride] = laneIm[lane];
+                        }
+                    }
+                };
+
+                if (threadPool)
+                {
+                    threadPool->ParallelFor(groupCount, transformGroup);
+                }
+                else
+                {
+                    for (int group = 0; group < groupCount; ++group)
+                        transformGroup(group, 0);
+                }
+            }
+        }
+
+    private:
+        int m_dims[3];
+        Plan m_plans[3];
+    };
+}
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../../fastnoise/DX12Utils/stb/stb_image.h"
+
+#define TINYEXR_IMPLEMENTATION
+#include "../../fastnoise/DX12Utils/tinyexr/tinyexr.h"
+
+#include "ImageLoader.h"
+#include <algorithm>
+#include <string.h>
+
+static void ClearPixels(LoadedImage& image)
+{
+    const size_t pixelCount = size_t(image.width) * image.height;
+    image.pixels.resize(pixelCount * 4);
+    for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+    {
+        image.pixels[pixel * 4 + 0] = image.pixels[pixel * 4 + 1] = image.pixels[pixel * 4 + 2] = 0.0f;
+        image.pixels[pixel * 4 + 3] = 1.0f;
+    }
+}
+
+static bool LoadEXR(const char* fileName, LoadedImage& image)
+{
+    EXRVersion version;
+    EXRHeader header;
+    InitEXRHeader(&header);
+    const char* err = nullptr;
+    if (ParseEXRVersionFromFile(&version, fileName) != TINYEXR_SUCCESS || version.multipart ||
+        ParseEXRHeaderFromFile(&header, &version, fileName, &err) != TINYEXR_SUCCESS)
+    {
+        if (err)
+            FreeEXRErrorMessage(err);
+        return false;
+    }
+
+    for (int i = 0; i < header.num_channels; ++i)
+        header.requested_pixel_types[i] = TINYEXR_PIXELTYPE_FLOAT;
+
+    EXRImage exrImage;
+    InitEXRImage(&exrImage);
+    if (LoadEXRImageFromFile(&exrImage, &header, fileName, &err) != TINYEXR_SUCCESS)
+    {
+        if (err)
+            FreeEXRErrorMessage(err);
+        FreeEXRHeader(&header);
+        return false;
+    }
+
+    image.width = exrImage.width;
+    image.height = exrImage.height;
+    image.components = 0;
+    image.isFloat = true;
+    ClearPixels(image);
+
+    // FastNoise writes the channels (A)BGR, so they are matched by name rather than position
+    static const char* c_channelNames[4] = { "R", "G", "B", "A" };
+    const size_t pixelCount = size_t(image.width) * image.height;
+    for (int i = 0; i < header.num_channels; ++i)
+    {
+        for (int channel = 0; channel < 4; ++channel)
+        {
+            if (strcmp(header.channels[i].name, c_channelNames[channel]))
+                continue;
+            const float* plane = (const float*)exrImage.images[i];
+            for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+                image.pixels[pixel * 4 + channel] = plane[pixel];
+            image.components = std::max(image.components, channel + 1);
+        }
+    }
+
+    FreeEXRImage(&exrImage);
+    FreeEXRHeader(&header);
+    return image.components > 0;
+}
+
+template <typename T>
+static void ExpandPixels(LoadedImage& image, const T* src, float scale)
+{
+    ClearPixels(image);
+    const size_t pixelCount = size_t(image.width) * image.height;
+    for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+    {
+        for (int i = 0; i < image.components; ++i)
+            image.pixels[pixel * 4 + i] = float(src[pixel * image.components + i]) * scale;
+    }
+}
+
+bool LoadImage(const char* fileName, LoadedImage& image)
+{
+    const char* extension = strrchr(fileName, '.');
+    if (extension && !_stricmp(extension, ".exr"))
+        return LoadEXR(fileName, image);
+
+    image.isFloat = stbi_is_hdr(fileName) != 0;
+    if (image.isFloat)
+    {
+        float* data = stbi_loadf(fileName, &image.width, &image.height, &image.components, 0);
+        if (!data)
+            return false;
+        ExpandPixels(image, data, 1.0f);
+        stbi_image_free(data);
+    }
+    else if (stbi_is_16_bit(fileName))
+    {
+        stbi_us* data = stbi_load_16(fileName, &image.width, &image.height, &image.components, 0);
+        if (!data)
+            return false;
+        ExpandPixels(image, data, 1.0f / 65535.0f);
+        stbi_image_free(data);
+    }
+    else
+    {
+        stbi_uc* data = stbi_load(fileName, &image.width, &image.height, &image.components, 0);
+        if (!data)
+            return false;
+        ExpandPixels(image, data, 1.0f / 255.0f);
+        stbi_image_free(data);
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Loads the PNG, HDR and EXR files FastNoise writes, as RGBA floats, for the tools. 8 and 16 bit values become
+// value / 255 or value / 65535, the same as matplotlib's imread gives the python scripts. A two channel PNG is stored
+// gray alpha, and its channels become RG. EXR channels are found by name. Channels a file doesn't have are 0, and
+// alpha is 1.
+struct LoadedImage
+{
+    int width = 0;
+    int height = 0;
+    int components = 0;         // How many channels the file has
+    bool isFloat = false;       // HDR and EXR
+    std::vector<float> pixels;  // width * height RGBA
+};
+
+bool LoadImage(const char* fileName, LoadedImage& image);
+
+// The name of a file written next to an image: the image's name with its extension replaced by suffix, like "_spectrum.png"
+inline std::string OutputFileName(const std::string& imageFileName, const char* suffix)
+{
+    size_t dot = imageFileName.rfind('.');
+    size_t slash = imageFileName.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return imageFileName + suffix;
+    return imageFileName.substr(0, dot) + suffix;
+}
@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <math.h>
+#include <random>
+#include <string.h>
+
+// The sample spaces of the analysis tools, and the random Heaviside functions of them that the python scripts use to
+// turn a texture into 0/1 masks. How well the noise does is how well the filtered masks estimate their own mean.
+
+inline constexpr double c_pi = 3.14159265358979323846;
+
+enum class SampleSpace
+{
+    Real,
+    Circle,
+    Vector2,
+    Vector3,
+    Vector4,
+    Sphere,
+};
+
+struct SampleSpaceInfo
+{
+    const char* name;
+    SampleSpace sampleSpace;
+    int components;
+};
+
+inline const SampleSpaceInfo c_sampleSpaces[] =
+{
+    { "real", SampleSpace::Real, 1 },
+    { "circle", SampleSpace::Circle, 1 },
+    { "vector2", SampleSpace::Vector2, 2 },
+    { "vector3", SampleSpace::Vector3, 3 },
+    { "vector4", SampleSpace::Vector4, 4 },
+    { "sphere", SampleSpace::Sphere, 3 },
+};
+
+// A random Heaviside function of the sample space: a pixel is in the mask if dot(direction, value) < threshold.
+// Real and circle use direction.x = 1 and do the comparison their own way.
+struct Heaviside
+{
+    double direction[4] = {};
+    double threshold = 0.0;
+};
+
+// Real and circle thresholds are stratified: sample sampleIndex of sampleCount is in the sampleIndex-th interval
+inline Heaviside MakeHeaviside(SampleSpace sampleSpace, int sampleIndex, int sampleCount, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    Heaviside ret;
+    switch (sampleSpace)
+    {
+        // Thresholds over [-1, 1) and [0, 2)
+        case SampleSpace::Real:
+        {
+            ret.direction[0] = 1.0;
+            ret.threshold = 2.0 * (sampleIndex + dist(rng)) / sampleCount - 1.0;
+            break;
+        }
+        case SampleSpace::Circle:
+        {
+            ret.direction[0] = 1.0;
+            ret.threshold = 2.0 * (sampleIndex + dist(rng)) / sampleCount;
+            break;
+        }
+        case SampleSpace::Vector2:
+        {
+            double phi = 2.0 * c_pi * dist(rng);
+            ret.direction[0] = cos(phi);
+            ret.direction[1] = sin(phi);
+            ret.threshold = sqrt(2.0) * (2.0 * dist(rng) - 1.0);
+            break;
+        }
+        case SampleSpace::Vector3:
+        case SampleSpace::Sphere:
+        {
+            double phi = 2.0 * c_pi * dist(rng);
+            double u = 2.0 * dist(rng) - 1.0;
+            ret.direction[0] = sqrt(1.0 - u * u) * cos(phi);
+            ret.direction[1] = sqrt(1.0 - u * u) * sin(phi);
+            ret.direction[2] = u;
+            // Planes through the center of the sphere
+            ret.threshold = (sampleSpace == SampleSpace::Sphere) ? 0.0 : sqrt(3.0) * (2.0 * dist(rng) - 1.0);
+            break;
+        }
+        case SampleSpace::Vector4:
+        {
+            std::normal_distribution<double> normal(0.0, 1.0);
+            double length = 0.0;
+            for (int i = 0; i < 4; ++i)
+            {
+                ret.direction[i] = normal(rng);
+                length += ret.direction[i] * ret.direction[i];
+            }
+            length = sqrt(length);
+            for (int i = 0; i < 4; ++i)
+                ret.direction[i] /= length;
+            ret.threshold = 2.0 * (2.0 * dist(rng) - 1.0);
+            break;
+        }
+    }
+    return ret;
+}
+
+// Writes the 0/1 mask of a Heaviside function over the values, which are components floats per pixel
+inline void MakeMask(float* mask, const float* values, size_t pixelCount, int components, SampleSpace sampleSpace, const Heaviside& heaviside)
+{
+    for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+    {
+        const float* value = &values[pixel * components];
+        bool inside;
+        if (sampleSpace == SampleSpace::Circle)
+        {
+            // The threshold rotates the circle, which wraps at 2
+            double angle = heaviside.threshold + value[0];
+            inside = angle - 2.0 * floor(angle / 2.0) < 1.0;
+        }
+        else
+        {
+            double dot = 0.0;
+            for (int i = 0; i < components; ++i)
+                dot += heaviside.direction[i] * value[i];
+            inside = dot < heaviside.threshold;
+        }
+        mask[pixel] = inside ? 1.0f : 0.0f;
+    }
+}
+
+// Returns nullptr for an unknown name
+inline const SampleSpaceInfo* SampleSpaceFromString(const char* name)
+{
+    for (const SampleSpaceInfo& info : c_sampleSpaces)
+    {
+        if (!_stricmp(name, info.name))
+            return &info;
+    }
+    return nullptr;
+}
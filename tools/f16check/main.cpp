@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+// Checks VolumeTexture::ToF16, which the R16F and RGBA16F volume textures are written with, against a reference
+// conversion done in double precision, for every float. Returns 0 if they all match.
+
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+
+#include "../../ThreadPool.h"
+#include "../../VolumeTexture.h"
+
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+static const int c_reportCount = 10;
+
+// The half nearest to value, ties to even, worked out in double precision where scaling a float is exact
+static uint16_t ToF16Reference(float value)
+{
+    uint16_t sign = std::signbit(value) ? 0x8000 : 0;
+    double absValue = std::abs(double(value));
+
+    if (std::isnan(value))
+        return (uint16_t)(sign | 0x7E00);
+
+    // Denormal halves count in steps of 2^-24, and 1024 of those is the smallest normal half
+    if (absValue < std::ldexp(1.0, -14))
+        return (uint16_t)(sign | (uint16_t)std::nearbyint(absValue * std::ldexp(1.0, 24)));
+
+    if (absValue >= 65520.0)
+        return (uint16_t)(sign | 0x7C00);
+
+    // 11 bits of mantissa. Rounding up to 2048 carries into the exponent.
+    int exponent;
+    std::frexp(absValue, &exponent);
+    uint32_t mantissa = (uint32_t)std::nearbyint(std::ldexp(absValue, 11 - exponent));
+    return (uint16_t)(sign | (((exponent + 14) << 10) + (mantissa - 1024)));
+}
+
+// NaNs only have to stay NaNs
+static bool Matches(float value, uint16_t half)
+{
+    if (std::isnan(value))
+        return (half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0;
+    return half == ToF16Reference(value);
+}
+
+int main()
+{
+    std::atomic<uint64_t> mismatchCount{ 0 };
+    std::mutex reportMutex;
+
+    // Each index checks the floats with those top 16 bits
+    auto checkFloats = [&](int index, int threadIndex)
+    {
+        for (uint32_t low = 0; low < 0x10000; ++low)
+        {
+            uint32_t bits = ((uint32_t)index << 16) | low;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+
+            uint16_t half = VolumeTexture::ToF16(value);
+            if (Matches(value, half))
+                continue;
+
+            if (mismatchCount++ < c_reportCount)
+            {
+                std::lock_guard<std::mutex> lock(reportMutex);
+                printf("0x%08X (%g): 0x%04X, expected 0x%04X\n", bits, value, half, ToF16Reference(value));
+            }
+        }
+    };
+
+    ThreadPool threadPool;
+    threadPool.ParallelFor(0x10000, checkFloats);
+
+    if (mismatchCount > 0)
+    {
+        printf("[Error] %llu floats convert to the wrong half\n", (unsigned long long)mismatchCount);
+        return 1;
+    }
+
+    printf("All floats convert to the nearest half\n");
+    return 0;
+}
@@ -0,0 +1,514 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+// Times FastNoise.exe over a matrix of configurations, for judging changes to the loss and swap shaders.
+// The matrix is the sample spaces of scripts/makenoise-spatial.py, the spatial filters of makenoise.bat, and a few texture
+// sizes and temporal filters / combine modes. Every configuration runs with a fixed seed and step count, and with -trace,
+// and the numbers come from the trace:
+//
+//   itersPerSec   - steps per second, from the main thread's step spans. The first 10% of the steps are left out, as
+//                   they include uploading the initial state and the GPU raising its clocks.
+//   lossMs/swapMs - the GPU time of the CalculateLoss and Swap passes per step.
+//   nsPerPixelTap - lossMs over the number of pixels times the number of filter taps the loss visits per pixel, as
+//                   FastNoise works it out with the same rule as the shader's windowed path, so filters of different
+//                   sizes can be compared.
+//   peakMB        - the process's peak working set. GPU memory isn't included.
+//
+// Each configuration is run -repeat times and the fastest run is kept. Results go to a CSV. Given a CSV from an earlier
+// run with -baseline, each configuration is compared with it, and changes worse than -threshold percent are flagged as
+// regressions. Returns 2 if there are any, so this can gate a change.
+
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+
+#include <windows.h>
+#include <psapi.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#pragma comment(lib, "psapi.lib")
+
+static const unsigned int c_seed = 5489;
+
+struct SampleSpaceConfig
+{
+    const char* space;
+    const char* distribution;
+};
+
+// The same as scripts/makenoise-spatial.py
+static const SampleSpaceConfig c_sampleSpaces[] =
+{
+    { "real", "uniform" },
+    { "real", "tent" },
+    { "circle", "uniform" },
+    { "vector2", "uniform" },
+    { "sphere", "uniform" },
+    { "sphere", "cosine" },
+    { "vector3", "uniform" },
+    { "vector4", "uniform" },
+};
+
+struct FilterConfig
+{
+    const char* name;
+    const char* args;
+};
+
+// The spatial filters makenoise.bat uses
+static const FilterConfig c_filters[] =
+{
+    { "box3", "box 3" },
+    { "box5", "box 5" },
+    { "gauss1_0", "gauss 1.0" },
+    { "binomial2", "binomial 2" },
+    { "binomial4", "binomial 4" },
+};
+
+// Texture sizes, and the temporal filter and combine mode for the 3D ones, as in makenoise.bat
+struct LayoutConfig
+{
+    const char* name;
+    const char* args;
+    int size[3];
+};
+
+static const LayoutConfig c_layouts[] =
+{
+    { "64x64", "box 1 product", { 64, 64, 1 } },
+    { "128x128", "box 1 product", { 128, 128, 1 } },
+    { "256x256", "box 1 product", { 256, 256, 1 } },
+    { "128x128x32_exp_product", "exponential 0.1 0.1 product", { 128, 128, 32 } },
+    { "128x128x32_exp_separate", "exponential 0.1 0.1 separate 0.5", { 128, 128, 32 } },
+    { "128x128x32_gauss_product", "gauss 1.0 product", { 128, 128, 32 } },
+};
+
+struct Config
+{
+    std::string name;
+    std::string args;
+};
+
+struct Result
+{
+    double itersPerSec = 0.0;
+    double stepMs = 0.0;
+    double lossMs = 0.0;
+    double swapMs = 0.0;
+    double nsPerPixelTap = 0.0;
+    double peakMB = 0.0;
+    double seconds = 0.0;
+};
+
+// The columns of the CSV that are compared against a baseline, and which way is worse
+struct Measure
+{
+    const char* name;
+    double Result::* value;
+    bool higherIsBetter;
+};
+
+static const Measure c_measures[] =
+{
+    { "itersPerSec", &Result::itersPerSec, true },
+    { "nsPerPixelTap", &Result::nsPerPixelTap, false },
+    { "peakMB", &Result::peakMB, false },
+};
+
+static void PrintUsage()
+{
+    printf(
+        "\n"
+        "fastnoise-bench.exe [options]\n"
+        "\n"
+        "Runs FastNoise.exe over the configuration matrix and writes the timings to a CSV.\n"
+        "\n"
+        "Options:\n"
+        "\n"
+        "  -exe <path>          - FastNoise.exe to time. Defaults to FastNoise.exe, so run from the repository root.\n"
+        "\n"
+        "  -dir <folder>        - Where the textures, traces and logs go. Defaults to bench.\n"
+        "\n"
+        "  -out <csv>           - The results. Defaults to <dir>/bench.csv.\n"
+        "\n"
+        "  -steps <count>       - Steps per run. Defaults to 1000.\n"
+        "\n"
+        "  -repeat <count>      - Runs per configuration, keeping the fastest. Defaults to 3.\n"
+        "\n"
+        "  -only <text>         - Only run configurations whose name contains text. Can be given more than once.\n"
+        "\n"
+        "  -baseline <csv>      - Compare against the results of an earlier run.\n"
+        "\n"
+        "  -threshold <percent> - How much worse than the baseline counts as a regression. Defaults to 5.\n"
+        "\n"
+        "  -list                - Print the configurations and exit.\n"
+        "\n"
+    );
+}
+
+static std::vector<Config> MakeConfigs()
+{
+    std::vector<Config> configs;
+    for (const SampleSpaceConfig& sampleSpace : c_sampleSpaces)
+    {
+        for (const FilterConfig& filter : c_filters)
+        {
+            for (const LayoutConfig& layout : c_layouts)
+            {
+                char buffer[1024];
+                Config config;
+                sprintf_s(buffer, "%s_%s_%s_%s", sampleSpace.space, sampleSpace.distribution, filter.name, layout.name);
+                config.name = buffer;
+                sprintf_s(buffer, "%s %s %s %s %i %i %i", sampleSpace.space, sampleSpace.distribution, filter.args, layout.args, layout.size[0], layout.size[1], layout.size[2]);
+                config.args = buffer;
+                configs.push_back(config);
+            }
+        }
+    }
+    return configs;
+}
+
+// Runs the command line with its output going to logFileName, and returns the exit code, or -1 if it couldn't be started.
+// peakBytes is the process's peak working set.
+static int RunProcess(const std::string& commandLine, const char* logFileName, size_t& peakBytes)
+{
+    peakBytes = 0;
+
+    SECURITY_ATTRIBUTES securityAttributes = {};
+    securityAttributes.nLength = sizeof(securityAttributes);
+    securityAttributes.bInheritHandle = TRUE;
+    HANDLE log = CreateFileA(logFileName, GENERIC_WRITE, FILE_SHARE_READ, &securityAttributes, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (log == INVALID_HANDLE_VALUE)
+        return -1;
+
+    STARTUPINFOA startupInfo = {};
+    startupInfo.cb = sizeof(startupInfo);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+    startupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    startupInfo.hStdOutput = log;
+    startupInfo.hStdError = log;
+
+    PROCESS_INFORMATION processInfo = {};
+    std::vector<char> mutableCommandLine(commandLine.begin(), commandLine.end());
+    mutableCommandLine.push_back(0);
+    if (!CreateProcessA(nullptr, mutableCommandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startupInfo, &processInfo))
+    {
+        CloseHandle(log);
+        return -1;
+    }
+
+    WaitForSingleObject(processInfo.hProcess, INFINITE);
+
+    DWORD exitCode = 0;
+    GetExitCodeProcess(processInfo.hProcess, &exitCode);
+
+    PROCESS_MEMORY_COUNTERS memoryCounters = {};
+    memoryCounters.cb = sizeof(memoryCounters);
+    if (GetProcessMemoryInfo(processInfo.hProcess, &memoryCounters, sizeof(memoryCounters)))
+        peakBytes = memoryCounters.PeakWorkingSetSize;
+
+    CloseHandle(processInfo.hThread);
+    CloseHandle(processInfo.hProcess);
+    CloseHandle(log);
+    return (int)exitCode;
+}
+
+// Reads a number from the trace's otherData
+static bool ReadTraceValue(const std::string& trace, const char* name, double& value)
+{
+    std::string key = std::string("\"") + name + "\": ";
+    size_t pos = trace.find(key);
+    if (pos == std::string::npos)
+        return false;
+    value = atof(trace.c_str() + pos + key.size());
+    return true;
+}
+
+// Reads the spans of a trace written by FastNoise.exe -trace, which has an event per line
+static bool ReadTrace(const char* fileName, Result& result)
+{
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "rb");
+    if (!file)
+        return false;
+
+    std::string trace;
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        trace.append(buffer, count);
+    fclose(file);
+
+    double pixels = 0.0, filterTaps = 0.0, steps = 0.0;
+    if (!ReadTraceValue(trace, "pixels", pixels) || !ReadTraceValue(trace, "filterTaps", filterTaps) || !ReadTraceValue(trace, "steps", steps))
+        return false;
+
+    const int firstStep = int(steps) / 10;
+
+    double stepUs = 0.0, lossUs = 0.0, swapUs = 0.0;
+    int stepCount = 0, lossCount = 0, swapCount = 0;
+    size_t lineStart = 0;
+    while (lineStart < trace.size())
+    {
+        size_t lineEnd = trace.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = trace.size();
+        std::string line = trace.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        char name[64], category[16];
+        double ts, dur;
+        if (sscanf_s(line.c_str(), "{\"name\": \"%63[^\"]\", \"cat\": \"%15[^\"]\", \"ph\": \"X\", \"ts\": %lf, \"dur\": %lf", name, (unsigned)_countof(name), category, (unsigned)_countof(category), &ts, &dur) != 4)
+            continue;
+
+        size_t stepPos = line.find("\"step\": ");
+        if (stepPos == std::string::npos || atoi(line.c_str() + stepPos + 8) < firstStep)
+            continue;
+
+        if (!strcmp(name, "step"))
+        {
+            stepUs += dur;
+            stepCount++;
+        }
+        else if (!strcmp(name, "CalculateLoss"))
+        {
+            lossUs += dur;
+            lossCount++;
+        }
+        else if (!strcmp(name, "Swap"))
+        {
+            swapUs += dur;
+            swapCount++;
+        }
+    }
+
+    if (stepCount == 0 || stepUs <= 0.0)
+        return false;
+
+    result.itersPerSec = double(stepCount) * 1000000.0 / stepUs;
+    result.stepMs = stepUs / 1000.0 / double(stepCount);
+    result.lossMs = (lossCount > 0) ? lossUs / 1000.0 / double(lossCount) : 0.0;
+    result.swapMs = (swapCount > 0) ? swapUs / 1000.0 / double(swapCount) : 0.0;
+    result.nsPerPixelTap = result.lossMs * 1000000.0 / (pixels * filterTaps);
+    return true;
+}
+
+static std::map<std::string, Result> ReadResults(const char* fileName)
+{
+    std::map<std::string, Result> results;
+
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "rb");
+    if (!file)
+        return results;
+
+    char line[4096];
+    bool header = true;
+    while (fgets(line, sizeof(line), file))
+    {
+        if (header)
+        {
+            header = false;
+            continue;
+        }
+
+        char name[1024];
+        Result result;
+        if (sscanf_s(line, "\"%1023[^\"]\",%lf,%lf,%lf,%lf,%lf,%lf,%lf", name, (unsigned)_countof(name), &result.itersPerSec, &result.stepMs, &result.lossMs, &result.swapMs,
+            &result.nsPerPixelTap, &result.peakMB, &result.seconds) == 8)
+        {
+            results[name] = result;
+        }
+    }
+    fclose(file);
+    return results;
+}
+
+int main(int argc, char** argv)
+{
+    std::string exe = "FastNoise.exe";
+    std::string dir = "bench";
+    std::string outFileName;
+    const char* baselineFileName = nullptr;
+    double threshold = 5.0;
+    int steps = 1000;
+    int repeat = 3;
+    bool list = false;
+    std::vector<std::string> only;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!_stricmp(argv[i], "-exe") && i + 1 < argc)
+            exe = argv[++i];
+        else if (!_stricmp(argv[i], "-dir") && i + 1 < argc)
+            dir = argv[++i];
+        else if (!_stricmp(argv[i], "-out") && i + 1 < argc)
+            outFileName = argv[++i];
+        else if (!_stricmp(argv[i], "-steps") && i + 1 < argc)
+            steps = atoi(argv[++i]);
+        else if (!_stricmp(argv[i], "-repeat") && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else if (!_stricmp(argv[i], "-only") && i + 1 < argc)
+            only.push_back(argv[++i]);
+        else if (!_stricmp(argv[i], "-baseline") && i + 1 < argc)
+            baselineFileName = argv[++i];
+        else if (!_stricmp(argv[i], "-threshold") && i + 1 < argc)
+            threshold = atof(argv[++i]);
+        else if (!_stricmp(argv[i], "-list"))
+            list = true;
+        else
+        {
+            printf("[Error] Unknown option \"%s\"\n\n", argv[i]);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (steps < 10 || repeat < 1)
+    {
+        printf("[Error] -steps must be at least 10 and -repeat at least 1\n");
+        return 1;
+    }
+
+    if (outFileName.empty())
+        outFileName = dir + "/bench.csv";
+
+    std::vector<Config> configs = MakeConfigs();
+    if (!only.empty())
+    {
+        configs.erase(std::remove_if(configs.begin(), configs.end(),
+            [&](const Config& config)
+            {
+                for (const std::string& text : only)
+                {
+                    if (config.name.find(text) != std::string::npos)
+                        return false;
+                }
+                return true;
+            }
+        ), configs.end());
+    }
+
+    if (list)
+    {
+        for (const Config& config : configs)
+            printf("%s: %s\n", config.name.c_str(), config.args.c_str());
+        return 0;
+    }
+
+    std::map<std::string, Result> baseline;
+    if (baselineFileName)
+    {
+        baseline = ReadResults(baselineFileName);
+        if (baseline.empty())
+        {
+            printf("[Error] Could not read baseline \"%s\"\n", baselineFileName);
+            return 1;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+
+    FILE* outFile = nullptr;
+    fopen_s(&outFile, outFileName.c_str(), "wb");
+    if (!outFile)
+    {
+        printf("[Error] Could not open file for writing \"%s\".\n", outFileName.c_str());
+        return 1;
+    }
+    fprintf(outFile, "\"config\",\"itersPerSec\",\"stepMs\",\"lossMs\",\"swapMs\",\"nsPerPixelTap\",\"peakMB\",\"seconds\"\n");
+
+    int failures = 0;
+    int regressions = 0;
+    printf("%-48s %12s %10s %10s %10s %14s %10s\n", "config", "iters/sec", "step ms", "loss ms", "swap ms", "ns/pixel-tap", "peak MB");
+    for (const Config& config : configs)
+    {
+        std::string base = dir + "/" + config.name;
+        std::string traceFileName = base + ".trace.json";
+        std::string logFileName = base + ".log";
+
+        char commandLine[2048];
+        sprintf_s(commandLine, "\"%s\" %s \"%s\" -seed %u -numsteps %i -trace \"%s\"", exe.c_str(), config.args.c_str(), base.c_str(), c_seed, steps, traceFileName.c_str());
+
+        // Keep the fastest run, and the highest peak memory of any
+        Result best;
+        double peakMB = 0.0;
+        bool succeeded = true;
+        for (int run = 0; run < repeat && succeeded; ++run)
+        {
+            ULONGLONG start = GetTickCount64();
+            size_t peakBytes = 0;
+            int exitCode = RunProcess(commandLine, logFileName.c_str(), peakBytes);
+
+            Result result;
+            succeeded = exitCode == 0 && ReadTrace(traceFileName.c_str(), result);
+            if (!succeeded)
+            {
+                printf("[Error] %s failed with exit code %i, see %s\n", config.name.c_str(), exitCode, logFileName.c_str());
+                break;
+            }
+            result.seconds = double(GetTickCount64() - start) / 1000.0;
+            peakMB = std::max(peakMB, double(peakBytes) / (1024.0 * 1024.0));
+
+            if (run == 0 || result.itersPerSec > best.itersPerSec)
+                best = result;
+        }
+
+        if (!succeeded)
+        {
+            failures++;
+            continue;
+        }
+        best.peakMB = peakMB;
+
+        printf("%-48s %12.1f %10.4f %10.4f %10.4f %14.5f %10.1f\n", config.name.c_str(), best.itersPerSec, best.stepMs, best.lossMs, best.swapMs, best.nsPerPixelTap, best.peakMB);
+        fprintf(outFile, "\"%s\",%f,%f,%f,%f,%f,%f,%f\n", config.name.c_str(), best.itersPerSec, best.stepMs, best.lossMs, best.swapMs, best.nsPerPixelTap, best.peakMB, best.seconds);
+        fflush(outFile);
+
+        auto it = baseline.find(config.name);
+        if (it == baseline.end())
+            continue;
+
+        for (const Measure& measure : c_measures)
+        {
+            double before = it->second.*measure.value;
+            double after = best.*measure.value;
+            if (before <= 0.0)
+                continue;
+
+            // Positive is worse
+            double change = 100.0 * (after - before) / before;
+            if (measure.higherIsBetter)
+                change = -change;
+
+            if (change > threshold)
+            {
+                printf("    REGRESSION %s: %f -> %f (%0.1f%% worse)\n", measure.name, before, after, change);
+                regressions++;
+            }
+            else if (change < -threshold)
+            {
+                printf("    improved %s: %f -> %f (%0.1f%% better)\n", measure.name, before, after, -change);
+            }
+        }
+    }
+    fclose(outFile);
+
+    printf("\n%i configurations, %i failed", (int)configs.size(), failures);
+    if (baselineFileName)
+        printf(", %i regressions above %g%%", regressions, threshold);
+    printf("\nResults written to %s\n", outFileName.c_str());
+
+    if (failures > 0)
+        return 1;
+    return (regressions > 0) ? 2 : 0;
+}
@@ -0,0 +1,584 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+// Checks that a FastNoise texture still has the distribution it was initialized with. The optimizer only swaps pixels, so the
+// histogram of its output should be the histogram of init.hlsl's samples, and a texture that fails here was written wrong or
+// made with different settings than it claims.
+//
+// One pass over the pixels, in parallel over chunks of them, fills a 256 bin histogram per channel and a 256 x 256 histogram
+// per pair of channels. The bins are the ones PixelConversion uses when writing 8 bit PNGs, so 8 bit and float textures are
+// binned the same way, and each channel is tested against the CDF of its marginal with a KS test and a chi-square test. The
+// components of the uniform vector distributions are independent, so for those each pair is also chi-square tested against the
+// product of the marginals, on cells big enough to expect 5 or more pixels each.
+//
+// Writes <name>_distribution.png, the 1D histograms with the expected counts marked, above the 2D histograms, and
+// <name>_distribution.csv, the observed and expected count of each bin. -summary appends a line per test to a CSV shared by
+// many textures. Returns 2 if any test fails, so a script can check a folder of textures with it.
+
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+
+#include "../common/ImageLoader.h"
+#include "../common/SampleSpace.h"
+#include "../../PNGEncoder.h"
+#include "../../ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static const int c_binCount = 256;
+static const char* c_channelNames[4] = { "r", "g", "b", "a" };
+
+// The distributions FastNoise.exe takes, named the same way
+enum class Distribution
+{
+    Uniform,
+    Tent,
+    Gauss,
+    Cosine,
+    UniformHemisphere,
+};
+
+struct DistributionInfo
+{
+    const char* name;
+    Distribution distribution;
+};
+
+static const DistributionInfo c_distributions[] =
+{
+    { "uniform", Distribution::Uniform },
+    { "tent", Distribution::Tent },
+    { "gauss", Distribution::Gauss },
+    { "cosine", Distribution::Cosine },
+    { "uniformhemisphere", Distribution::UniformHemisphere },
+};
+
+// The CDF of a channel of init.hlsl's samples, as stored in the texture. Sphere directions are stored as 0.5 + 0.5 * w.
+// The components of a uniform sphere or hemisphere direction are uniform over [-1, 1], except for the hemisphere's z, which
+// is uniform over [0, 1]. A cosine weighted direction is a uniform point on the disk lifted to the hemisphere, so x and y have
+// the disk's semicircle marginal, and z^2 = 1 - r^2 is uniform.
+static double ExpectedCDF(Distribution distribution, int channel, double x)
+{
+    auto saturate = [](double value) { return std::min(std::max(value, 0.0), 1.0); };
+    switch (distribution)
+    {
+        case Distribution::Uniform:
+        {
+            return saturate(x);
+        }
+        case Distribution::Tent:
+        {
+            x = saturate(x);
+            return (x < 0.5) ? 2.0 * x * x : 1.0 - 2.0 * (1.0 - x) * (1.0 - x);
+        }
+        case Distribution::Gauss:
+        {
+            return 0.5 * (1.0 + erf((x - 0.5) / 0.15));
+        }
+        case Distribution::Cosine:
+        {
+            double w = std::min(std::max(2.0 * x - 1.0, -1.0), 1.0);
+            if (channel == 2)
+                return (w > 0.0) ? w * w : 0.0;
+            return 0.5 + (w * sqrt(1.0 - w * w) + asin(w)) / c_pi;
+        }
+        case Distribution::UniformHemisphere:
+        {
+            return (channel == 2) ? saturate(2.0 * x - 1.0) : saturate(x);
+        }
+    }
+    return 0.0;
+}
+
+// Matches PixelConversion's float to 8 bit conversion, which for an 8 bit PNG gives back the stored value
+static inline int Bin(float value)
+{
+    value *= float(c_binCount);
+    if (!(value < float(c_binCount - 1)))
+        value = (value == value) ? float(c_binCount - 1) : 0.0f;
+    if (!(value > 0.0f))
+        value = 0.0f;
+    return int(value);
+}
+
+// The probability of each bin. The end bins also hold what is outside of [0, 1].
+static std::vector<double> ExpectedBins(Distribution distribution, int channel)
+{
+    std::vector<double> ret(c_binCount);
+    double low = 0.0;
+    for (int bin = 0; bin < c_binCount; ++bin)
+    {
+        double high = (bin + 1 < c_binCount) ? ExpectedCDF(distribution, channel, double(bin + 1) / c_binCount) : 1.0;
+        ret[bin] = high - low;
+        low = high;
+    }
+    return ret;
+}
+
+// Q(a, x), the regularized upper incomplete gamma function: a series for P below a + 1 and a continued fraction above it
+static double GammaQ(double a, double x)
+{
+    if (x <= 0.0)
+        return 1.0;
+
+    const double logPrefix = a * log(x) - x - lgamma(a);
+    if (x < a + 1.0)
+    {
+        double term = 1.0 / a;
+        double sum = term;
+        for (int n = 1; n < 10000; ++n)
+        {
+            term *= x / (a + n);
+            sum += term;
+            if (term < sum * 1e-15)
+                break;
+        }
+        return std::max(1.0 - sum * exp(logPrefix), 0.0);
+    }
+
+    const double tiny = 1e-300;
+    double b = x + 1.0 - a;
+    double c = 1.0 / tiny;
+    double d = 1.0 / b;
+    double h = d;
+    for (int n = 1; n < 10000; ++n)
+    {
+        double an = -n * (n - a);
+        b += 2.0;
+        d = an * d + b;
+        if (fabs(d) < tiny)
+            d = tiny;
+        c = b + an / c;
+        if (fabs(c) < tiny)
+            c = tiny;
+        d = 1.0 / d;
+        double delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1.0) < 1e-15)
+            break;
+    }
+    return std::min(exp(logPrefix) * h, 1.0);
+}
+
+// The probability of a KS statistic of at least D, with Stephens' correction for the sample count
+static double KolmogorovPValue(double D, double n)
+{
+    double lambda = (sqrt(n) + 0.12 + 0.11 / sqrt(n)) * D;
+    if (lambda < 0.05)
+        return 1.0;
+
+    double sum = 0.0;
+    for (int k = 1; k <= 1000; ++k)
+    {
+        double term = 2.0 * exp(-2.0 * k * k * lambda * lambda);
+        sum += (k & 1) ? term : -term;
+        if (term < 1e-16)
+            break;
+    }
+    return std::min(std::max(sum, 0.0), 1.0);
+}
+
+struct TestResult
+{
+    std::string test;
+    std::string channels;
+    double statistic = 0.0;
+    double pValue = 1.0;
+};
+
+// KS over the bin edges. The data is binned, so this can only miss differences inside a bin, which the chi-square test sees.
+static TestResult KSTest(const uint64_t* counts, const std::vector<double>& expected, uint64_t n)
+{
+    double observedCDF = 0.0;
+    double expectedCDF = 0.0;
+    double D = 0.0;
+    for (int bin = 0; bin < c_binCount; ++bin)
+    {
+        observedCDF += double(counts[bin]) / double(n);
+        expectedCDF += expected[bin];
+        D = std::max(D, fabs(observedCDF - expectedCDF));
+    }
+
+    TestResult ret;
+    ret.test = "ks";
+    ret.statistic = D;
+    ret.pValue = KolmogorovPValue(D, double(n));
+    return ret;
+}
+
+// Neighboring bins are merged until each group expects at least 5 pixels, so the chi-square approximation holds
+static TestResult ChiSquareTest(const std::vector<double>& observed, const std::vector<double>& expected)
+{
+    const double c_minExpected = 5.0;
+
+    double chiSquare = 0.0;
+    int groupCount = 0;
+    double groupObserved = 0.0;
+    double groupExpected = 0.0;
+    double lastObserved = 0.0;
+    double lastExpected = 0.0;
+    for (size_t i = 0; i < observed.size(); ++i)
+    {
+        groupObserved += observed[i];
+        groupExpected += expected[i];
+        if (groupExpected >= c_minExpected)
+        {
+            chiSquare += (groupObserved - groupExpected) * (groupObserved - groupExpected) / groupExpected;
+            groupCount++;
+            lastObserved = groupObserved;
+            lastExpected = groupExpected;
+            groupObserved = 0.0;
+            groupExpected = 0.0;
+        }
+    }
+
+    // What is left over joins the last group
+    if (groupObserved > 0.0 || groupExpected > 0.0)
+    {
+        if (groupCount > 0)
+        {
+            chiSquare -= (lastObserved - lastExpected) * (lastObserved - lastExpected) / lastExpected;
+            lastObserved += groupObserved;
+            lastExpected += groupExpected;
+        }
+        else
+        {
+            lastObserved = groupObserved;
+            lastExpected = groupExpected;
+            groupCount = 1;
+        }
+        if (lastExpected > 0.0)
+            chiSquare += (lastObserved - lastExpected) * (lastObserved - lastExpected) / lastExpected;
+    }
+
+    TestResult ret;
+    ret.test = "chisquare";
+    ret.statistic = chiSquare;
+    ret.pValue = (groupCount > 1) ? GammaQ(0.5 * double(groupCount - 1), 0.5 * chiSquare) : 1.0;
+    return ret;
+}
+
+static void PrintUsage()
+{
+    printf(
+        "fastnoise-histogram.exe <fileName> <sampleSpace> <distribution> [-alpha <p>] [-summary <csvFileName>] [-threads <count>]\n"
+        "  <fileName>     - A PNG, HDR or EXR FastNoise texture.\n"
+        "  <sampleSpace>  - real | circle | vector2 | vector3 | vector4 | sphere\n"
+        "  <distribution> - uniform | tent | gauss | cosine | uniformhemisphere, as given to FastNoise.exe\n"
+        "  -alpha         - A test fails if its p value is below this. Defaults to 0.001.\n"
+        "  -summary       - Appends each test's result to this CSV file.\n"
+        "  -threads       - Worker threads, 0 for one per hardware thread. Defaults to 0.\n"
+        "Writes <name>_distribution.png and <name>_distribution.csv next to the texture.\n"
+        "Returns 0 if every test passes, 2 if any fails, and 1 on errors.\n"
+    );
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* fileName = argv[1];
+    const SampleSpaceInfo* sampleSpaceInfo = SampleSpaceFromString(argv[2]);
+    if (!sampleSpaceInfo)
+    {
+        printf("[Error] Unknown sample space \"%s\"\n\n", argv[2]);
+        PrintUsage();
+        return 1;
+    }
+
+    const DistributionInfo* distributionInfo = nullptr;
+    for (const DistributionInfo& info : c_distributions)
+    {
+        if (!_stricmp(argv[3], info.name))
+            distributionInfo = &info;
+    }
+    if (!distributionInfo)
+    {
+        printf("[Error] Unknown distribution \"%s\"\n\n", argv[3]);
+        PrintUsage();
+        return 1;
+    }
+
+    // The same combinations FastNoise.exe allows
+    const SampleSpace sampleSpace = sampleSpaceInfo->sampleSpace;
+    const Distribution distribution = distributionInfo->distribution;
+    if ((distribution == Distribution::Tent || distribution == Distribution::Gauss) && sampleSpace != SampleSpace::Real)
+    {
+        printf("[Error] Only \"real\" sampleSpace can be %s distributed.\n", distributionInfo->name);
+        return 1;
+    }
+    if ((distribution == Distribution::Cosine || distribution == Distribution::UniformHemisphere) && sampleSpace != SampleSpace::Sphere)
+    {
+        printf("[Error] Only \"sphere\" sampleSpace can be %s distributed.\n", distributionInfo->name);
+        return 1;
+    }
+
+    double alpha = 0.001;
+    const char* summaryFileName = nullptr;
+    int threadCount = 0;
+    for (int i = 4; i < argc; ++i)
+    {
+        if (!_stricmp(argv[i], "-alpha") && i + 1 < argc)
+            alpha = atof(argv[++i]);
+        else if (!_stricmp(argv[i], "-summary") && i + 1 < argc)
+            summaryFileName = argv[++i];
+        else if (!_stricmp(argv[i], "-threads") && i + 1 < argc)
+            threadCount = atoi(argv[++i]);
+        else
+        {
+            printf("[Error] Unknown option \"%s\"\n\n", argv[i]);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    LoadedImage image;
+    if (!LoadImage(fileName, image))
+    {
+        printf("[Error] Could not load \"%s\"\n", fileName);
+        return 1;
+    }
+
+    const int components = sampleSpaceInfo->components;
+    const size_t pixelCount = size_t(image.width) * image.height;
+
+    std::vector<std::pair<int, int>> pairs;
+    for (int a = 0; a < components; ++a)
+    {
+        for (int b = a + 1; b < components; ++b)
+            pairs.push_back({ a, b });
+    }
+    const int pairCount = (int)pairs.size();
+
+    // The histograms, one set per thread, summed into the first
+    struct Histograms
+    {
+        std::vector<uint64_t> bins;     // components * c_binCount
+        std::vector<uint64_t> pairBins; // pairCount * c_binCount * c_binCount, indexed [pair][b][a]
+    };
+
+    ThreadPool threadPool(threadCount);
+    const int poolThreadCount = threadPool.GetThreadCount() + 1;
+    std::vector<Histograms> threadHistograms(poolThreadCount);
+
+    const size_t c_chunkSize = 64 * 1024;
+    const int chunkCount = (int)((pixelCount + c_chunkSize - 1) / c_chunkSize);
+    threadPool.ParallelFor(chunkCount,
+        [&](int chunk, int threadIndex)
+        {
+            Histograms& histograms = threadHistograms[threadIndex];
+            if (histograms.bins.empty())
+            {
+                histograms.bins.resize(size_t(components) * c_binCount, 0);
+                histograms.pairBins.resize(size_t(pairCount) * c_binCount * c_binCount, 0);
+            }
+
+            const size_t begin = size_t(chunk) * c_chunkSize;
+            const size_t end = std::min(begin + c_chunkSize, pixelCount);
+            for (size_t pixel = begin; pixel < end; ++pixel)
+            {
+                int bins[4];
+                for (int i = 0; i < components; ++i)
+                {
+                    bins[i] = Bin(image.pixels[pixel * 4 + i]);
+                    histograms.bins[i * c_binCount + bins[i]]++;
+                }
+                for (int pair = 0; pair < pairCount; ++pair)
+                    histograms.pairBins[(size_t(pair) * c_binCount + bins[pairs[pair].second]) * c_binCount + bins[pairs[pair].first]]++;
+            }
+        }
+    );
+
+    Histograms histograms;
+    histograms.bins.resize(size_t(components) * c_binCount, 0);
+    histograms.pairBins.resize(size_t(pairCount) * c_binCount * c_binCount, 0);
+    for (const Histograms& threadHistogram : threadHistograms)
+    {
+        for (size_t i = 0; i < threadHistogram.bins.size(); ++i)
+            histograms.bins[i] += threadHistogram.bins[i];
+        for (size_t i = 0; i < threadHistogram.pairBins.size(); ++i)
+            histograms.pairBins[i] += threadHistogram.pairBins[i];
+    }
+
+    // Test each channel against its marginal
+    std::vector<std::vector<double>> expected(components);
+    std::vector<TestResult> results;
+    for (int i = 0; i < components; ++i)
+    {
+        expected[i] = ExpectedBins(distribution, i);
+        const uint64_t* counts = &histograms.bins[i * c_binCount];
+
+        TestResult ks = KSTest(counts, expected[i], pixelCount);
+        ks.channels = c_channelNames[i];
+        results.push_back(ks);
+
+        std::vector<double> observed(counts, counts + c_binCount);
+        std::vector<double> expectedCounts(c_binCount);
+        for (int bin = 0; bin < c_binCount; ++bin)
+            expectedCounts[bin] = expected[i][bin] * double(pixelCount);
+        TestResult chiSquare = ChiSquareTest(observed, expectedCounts);
+        chiSquare.channels = c_channelNames[i];
+        results.push_back(chiSquare);
+    }
+
+    // Test the pairs for independence, on square cells of a power of two bins, as fine as keeps 5 pixels expected in each
+    const bool independent = distribution == Distribution::Uniform &&
+        (sampleSpace == SampleSpace::Vector2 || sampleSpace == SampleSpace::Vector3 || sampleSpace == SampleSpace::Vector4);
+    if (independent)
+    {
+        int cellsPerAxis = c_binCount;
+        while (cellsPerAxis > 2 && double(pixelCount) / double(cellsPerAxis * cellsPerAxis) < 5.0)
+            cellsPerAxis /= 2;
+        const int binsPerCell = c_binCount / cellsPerAxis;
+
+        for (int pair = 0; pair < pairCount; ++pair)
+        {
+            const int a = pairs[pair].first;
+            const int b = pairs[pair].second;
+            const uint64_t* counts = &histograms.pairBins[size_t(pair) * c_binCount * c_binCount];
+
+            std::vector<double> observed(size_t(cellsPerAxis) * cellsPerAxis, 0.0);
+            std::vector<double> expectedCounts(size_t(cellsPerAxis) * cellsPerAxis, 0.0);
+            for (int y = 0; y < c_binCount; ++y)
+            {
+                for (int x = 0; x < c_binCount; ++x)
+                {
+                    size_t cell = size_t(y / binsPerCell) * cellsPerAxis + x / binsPerCell;
+                    observed[cell] += double(counts[y * c_binCount + x]);
+                    expectedCounts[cell] += expected[a][x] * expected[b][y] * double(pixelCount);
+                }
+            }
+
+            TestResult chiSquare = ChiSquareTest(observed, expectedCounts);
+            chiSquare.channels = std::string(c_channelNames[a]) + c_channelNames[b];
+            results.push_back(chiSquare);
+        }
+    }
+
+    // The image: the 1D histograms in the top row, as bars with the expected count marked in white, and the 2D histograms
+    // below, with the first channel increasing to the right and the second up
+    const int tileSize = c_binCount;
+    const int tilesWide = std::max(components, pairCount);
+    const int tilesHigh = (pairCount > 0) ? 2 : 1;
+    const int imageWidth = tilesWide * tileSize;
+    const int imageHeight = tilesHigh * tileSize;
+    std::vector<float> histogramImage(size_t(imageWidth) * imageHeight, 0.0f);
+    for (int i = 0; i < components; ++i)
+    {
+        const uint64_t* counts = &histograms.bins[i * c_binCount];
+        double maxCount = 0.0;
+        for (int bin = 0; bin < c_binCount; ++bin)
+            maxCount = std::max(maxCount, std::max(double(counts[bin]), expected[i][bin] * double(pixelCount)));
+        if (maxCount <= 0.0)
+            continue;
+
+        for (int bin = 0; bin < c_binCount; ++bin)
+        {
+            int barHeight = int(double(counts[bin]) / maxCount * (tileSize - 1) + 0.5);
+            int expectedHeight = int(expected[i][bin] * double(pixelCount) / maxCount * (tileSize - 1) + 0.5);
+            for (int y = 0; y < barHeight; ++y)
+                histogramImage[size_t(tileSize - 1 - y) * imageWidth + i * tileSize + bin] = 0.5f;
+            histogramImage[size_t(tileSize - 1 - expectedHeight) * imageWidth + i * tileSize + bin] = 1.0f;
+        }
+    }
+    for (int pair = 0; pair < pairCount; ++pair)
+    {
+        const uint64_t* counts = &histograms.pairBins[size_t(pair) * c_binCount * c_binCount];
+        uint64_t maxCount = *std::max_element(counts, counts + c_binCount * c_binCount);
+        if (maxCount == 0)
+            continue;
+
+        for (int y = 0; y < c_binCount; ++y)
+        {
+            for (int x = 0; x < c_binCount; ++x)
+                histogramImage[size_t(2 * tileSize - 1 - y) * imageWidth + pair * tileSize + x] = float(double(counts[y * c_binCount + x]) / double(maxCount));
+        }
+    }
+
+    std::string imageFileName = OutputFileName(fileName, "_distribution.png");
+    PNGEncoder::Settings settings;
+    settings.threadPool = &threadPool;
+    if (!PNGEncoder::SaveF32(imageFileName.c_str(), histogramImage.data(), imageWidth, imageHeight, 1, 1, settings))
+    {
+        printf("[Error] Could not write \"%s\"\n", imageFileName.c_str());
+        return 1;
+    }
+
+    // The CSV: a row per bin, with the observed and expected count of each channel
+    std::string csvFileName = OutputFileName(fileName, "_distribution.csv");
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName.c_str(), "wb");
+    if (!file)
+    {
+        printf("[Error] Could not open file for writing \"%s\"\n", csvFileName.c_str());
+        return 1;
+    }
+
+    fprintf(file, "\"bin\",\"low\",\"high\"");
+    for (int i = 0; i < components; ++i)
+        fprintf(file, ",\"%s\",\"%s expected\"", c_channelNames[i], c_channelNames[i]);
+    fprintf(file, "\n");
+    for (int bin = 0; bin < c_binCount; ++bin)
+    {
+        fprintf(file, "\"%i\",\"%f\",\"%f\"", bin, double(bin) / c_binCount, double(bin + 1) / c_binCount);
+        for (int i = 0; i < components; ++i)
+            fprintf(file, ",\"%llu\",\"%g\"", (unsigned long long)histograms.bins[i * c_binCount + bin], expected[i][bin] * double(pixelCount));
+        fprintf(file, "\n");
+    }
+    fclose(file);
+
+    // Report the tests
+    bool passed = true;
+    printf("%s: %zu pixels, %s %s\n", fileName, pixelCount, sampleSpaceInfo->name, distributionInfo->name);
+    printf("  %-10s %-8s %14s %12s\n", "test", "channels", "statistic", "p value");
+    for (const TestResult& result : results)
+    {
+        bool failed = result.pValue < alpha;
+        passed = passed && !failed;
+        printf("  %-10s %-8s %14g %12g%s\n", result.test.c_str(), result.channels.c_str(), result.statistic, result.pValue, failed ? "  FAIL" : "");
+    }
+
+    if (summaryFileName)
+    {
+        // A header only when starting the file
+        FILE* summaryFile = nullptr;
+        fopen_s(&summaryFile, summaryFileName, "rb");
+        bool writeHeader = !summaryFile;
+        if (summaryFile)
+            fclose(summaryFile);
+
+        fopen_s(&summaryFile, summaryFileName, "ab");
+        if (!summaryFile)
+        {
+            printf("[Error] Could not open file for writing \"%s\"\n", summaryFileName);
+            return 1;
+        }
+        if (writeHeader)
+            fprintf(summaryFile, "\"file\",\"sampleSpace\",\"distribution\",\"test\",\"channels\",\"statistic\",\"pValue\",\"result\"\n");
+        for (const TestResult& result : results)
+        {
+            fprintf(summaryFile, "\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",\"%g\",\"%g\",\"%s\"\n", fileName, sampleSpaceInfo->name, distributionInfo->name,
+                result.test.c_str(), result.channels.c_str(), result.statistic, result.pValue, (result.pValue < alpha) ? "fail" : "pass");
+        }
+        fclose(summaryFile);
+    }
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - start).count();
+    printf("%s in %0.3f seconds\nWrote \"%s\" and \"%s\"\n", passed ? "Passed" : "FAILED", seconds, imageFileName.c_str(), csvFileName.c_str());
+    return passed ? 0 : 2;
+}
@@ -0,0 +1,273 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+// The native version of scripts/spectrum.py. The texture is read as a stack of square slices, and for each of a number of
+// random Heaviside functions of the sample space, the FFT of the 0/1 mask it makes of the texture is taken. The RMS of those
+// spectra, with the DC removed, shows which frequencies the noise has in it.
+//
+// Samples run in parallel, a pair per task: the masks are real, so two of them go through one complex FFT as its real and
+// imaginary parts. For real a and b, |A(k)|^2 + |B(k)|^2 = (|Z(k)|^2 + |Z(-k)|^2) / 2 where z = a + ib, so only |Z|^2 needs
+// summing, and it is symmetrized at the end.
+//
+// Writes <name>_spectrum.png, the RMS spectrum with the DC in the middle of each slice, scaled so the largest value is white,
+// and <name>_spectrum.csv, the mean square spectrum averaged over shells of equal frequency magnitude. The CSV is normalized
+// by the sample and pixel counts, so white noise masks give a flat line at the masks' variance, at most 0.25.
+
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+
+#include "../common/FFT.h"
+#include "../common/ImageLoader.h"
+#include "../common/SampleSpace.h"
+#include "../../PNGEncoder.h"
+#include "../../ThreadPool.h"
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Each sample has its own generator, so the result doesn't depend on which thread runs it
+static Heaviside MakeSampleHeaviside(SampleSpace sampleSpace, int sampleIndex, int sampleCount, unsigned int seed)
+{
+    std::seed_seq seq{ seed, (unsigned int)sampleIndex };
+    std::mt19937 rng(seq);
+    return MakeHeaviside(sampleSpace, sampleIndex, sampleCount, rng);
+}
+
+static void PrintUsage()
+{
+    printf(
+        "fastnoise-spectrum.exe <fileName> <sampleSpace> [-samples <count>] [-seed <seed>] [-threads <count>]\n"
+        "  <fileName>    - A PNG, HDR or EXR FastNoise texture. Taller than wide is read as a stack of square slices.\n"
+        "  <sampleSpace> - real | circle | vector2 | vector3 | vector4 | sphere\n"
+        "  -samples      - How many random Heaviside functions to average over. Defaults to 256.\n"
+        "  -seed         - Seeds the random Heaviside functions. Defaults to 0.\n"
+        "  -threads      - Worker threads, 0 for one per hardware thread. Defaults to 0.\n"
+        "Writes <name>_spectrum.png and <name>_spectrum.csv next to the texture.\n"
+    );
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* fileName = argv[1];
+    const SampleSpaceInfo* sampleSpaceInfo = SampleSpaceFromString(argv[2]);
+    if (!sampleSpaceInfo)
+    {
+        printf("[Error] Unknown sample space \"%s\"\n\n", argv[2]);
+        PrintUsage();
+        return 1;
+    }
+
+    int sampleCount = 256;
+    unsigned int seed = 0;
+    int threadCount = 0;
+    for (int i = 3; i < argc; ++i)
+    {
+        if (!_stricmp(argv[i], "-samples") && i + 1 < argc)
+            sampleCount = atoi(argv[++i]);
+        else if (!_stricmp(argv[i], "-seed") && i + 1 < argc)
+            seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+        else if (!_stricmp(argv[i], "-threads") && i + 1 < argc)
+            threadCount = atoi(argv[++i]);
+        else
+        {
+            printf("[Error] Unknown option \"%s\"\n\n", argv[i]);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (sampleCount < 1)
+    {
+        printf("[Error] -samples must be at least 1\n");
+        return 1;
+    }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    LoadedImage image;
+    if (!LoadImage(fileName, image))
+    {
+        printf("[Error] Could not load \"%s\"\n", fileName);
+        return 1;
+    }
+
+    if (image.height % image.width != 0)
+    {
+        printf("[Error] \"%s\" is %i x %i, which isn't a stack of square slices\n", fileName, image.width, image.height);
+        return 1;
+    }
+
+    const int width = image.width;
+    const int height = image.width;
+    const int depth = image.height / image.width;
+    const size_t pixelCount = size_t(width) * height * depth;
+    printf("Dimensions %i x %i, interpreting as %i x %i x %i\n", image.width, image.height, width, height, depth);
+
+    // The sample space's channels, with 8 bit values mapped from [0, 1] to [-1, 1) the way spectrum.py does
+    const SampleSpace sampleSpace = sampleSpaceInfo->sampleSpace;
+    const int components = sampleSpaceInfo->components;
+    std::vector<float> values(pixelCount * components);
+    for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+    {
+        for (int i = 0; i < components; ++i)
+        {
+            float value = image.pixels[pixel * 4 + i];
+            values[pixel * components + i] = image.isFloat ? value : (value - 0.5f) * 2.0f * 255.0f / 256.0f;
+        }
+    }
+
+    ThreadPool threadPool(threadCount);
+    const int poolThreadCount = threadPool.GetThreadCount() + 1;
+    const FFT::Plan3D plan(width, height, depth);
+
+    struct ThreadData
+    {
+        std::vector<float> re;
+        std::vector<float> im;
+        std::vector<double> powerSum;
+    };
+    std::vector<ThreadData> threadData(poolThreadCount);
+
+    const int pairCount = (sampleCount + 1) / 2;
+    threadPool.ParallelFor(pairCount,
+        [&](int pair, int threadIndex)
+        {
+            ThreadData& data = threadData[threadIndex];
+            if (data.powerSum.empty())
+            {
+                data.re.resize(pixelCount);
+                data.im.resize(pixelCount);
+                data.powerSum.resize(pixelCount, 0.0);
+            }
+
+            const int sampleA = pair * 2;
+            const int sampleB = sampleA + 1;
+            MakeMask(data.re.data(), values.data(), pixelCount, components, sampleSpace, MakeSampleHeaviside(sampleSpace, sampleA, sampleCount, seed));
+            if (sampleB < sampleCount)
+                MakeMask(data.im.data(), values.data(), pixelCount, components, sampleSpace, MakeSampleHeaviside(sampleSpace, sampleB, sampleCount, seed));
+            else
+                std::fill(data.im.begin(), data.im.end(), 0.0f);
+
+            // The pairs are what run in parallel, so each FFT is on this thread
+            plan.Forward(data.re.data(), data.im.data(), nullptr);
+
+            for (size_t i = 0; i < pixelCount; ++i)
+                data.powerSum[i] += double(data.re[i]) * double(data.re[i]) + double(data.im[i]) * double(data.im[i]);
+        }
+    );
+
+    std::vector<double> powerSum(pixelCount, 0.0);
+    for (const ThreadData& data : threadData)
+    {
+        for (size_t i = 0; i < data.powerSum.size(); ++i)
+            powerSum[i] += data.powerSum[i];
+    }
+
+    // Mean square spectrum per sample and pixel, symmetrized to separate the pairs, with the DC removed
+    auto index = [&](int x, int y, int z) { return (size_t(z) * height + y) * width + x; };
+    std::vector<double> meanSquare(pixelCount);
+    const double normalization = 1.0 / (double(sampleCount) * double(pixelCount));
+    for (int z = 0; z < depth; ++z)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                size_t negative = index((width - x) % width, (height - y) % height, (depth - z) % depth);
+                meanSquare[index(x, y, z)] = 0.5 * (powerSum[index(x, y, z)] + powerSum[negative]) * normalization;
+            }
+        }
+    }
+    meanSquare[0] = 0.0;
+
+    // The RMS spectrum image, fftshifted so the DC is in the middle
+    double maxRMS = 0.0;
+    for (double value : meanSquare)
+        maxRMS = std::max(maxRMS, sqrt(value));
+
+    std::vector<float> spectrumImage(pixelCount);
+    for (int z = 0; z < depth; ++z)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                double rms = sqrt(meanSquare[index(x, y, z)]);
+                spectrumImage[index((x + width / 2) % width, (y + height / 2) % height, (z + depth / 2) % depth)] = maxRMS > 0.0 ? float(rms / maxRMS) : 0.0f;
+            }
+        }
+    }
+
+    std::string imageFileName = OutputFileName(fileName, "_spectrum.png");
+    PNGEncoder::Settings settings;
+    settings.threadPool = &threadPool;
+    if (!PNGEncoder::SaveF32(imageFileName.c_str(), spectrumImage.data(), width, height * depth, 1, 1, settings))
+    {
+        printf("[Error] Could not write \"%s\"\n", imageFileName.c_str());
+        return 1;
+    }
+
+    // Radial average. Frequencies are in cycles per pixel on each axis, and the shells are 1 / (longest axis) apart.
+    const int binsPerUnit = std::max(width, std::max(height, depth));
+    auto frequency = [](int k, int n) { return double((k < (n + 1) / 2) ? k : k - n) / double(n); };
+    std::vector<double> binSum;
+    std::vector<size_t> binCount;
+    for (int z = 0; z < depth; ++z)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                if (x == 0 && y == 0 && z == 0)
+                    continue;
+                double fx = frequency(x, width);
+                double fy = frequency(y, height);
+                double fz = frequency(z, depth);
+                size_t bin = (size_t)floor(sqrt(fx * fx + fy * fy + fz * fz) * binsPerUnit + 0.5);
+                if (bin >= binSum.size())
+                {
+                    binSum.resize(bin + 1, 0.0);
+                    binCount.resize(bin + 1, 0);
+                }
+                binSum[bin] += meanSquare[index(x, y, z)];
+                binCount[bin]++;
+            }
+        }
+    }
+
+    std::string csvFileName = OutputFileName(fileName, "_spectrum.csv");
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName.c_str(), "wb");
+    if (!file)
+    {
+        printf("[Error] Could not open file for writing \"%s\"\n", csvFileName.c_str());
+        return 1;
+    }
+
+    fprintf(file, "\"frequency\",\"count\",\"meanSquare\",\"rms\"\n");
+    for (size_t bin = 1; bin < binSum.size(); ++bin)
+    {
+        if (binCount[bin] == 0)
+            continue;
+        double mean = binSum[bin] / double(binCount[bin]);
+        fprintf(file, "\"%f\",\"%zu\",\"%g\",\"%g\"\n", double(bin) / binsPerUnit, binCount[bin], mean, sqrt(mean));
+    }
+    fclose(file);
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - start).count();
+    printf("%i samples on %i threads in %0.2f seconds\nWrote \"%s\" and \"%s\"\n", sampleCount, poolThreadCount, seconds, imageFileName.c_str(), csvFileName.c_str());
+    return 0;
+}
@@ -0,0 +1,363 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+// The native version of scripts/temporal.py. The texture is read as a stack of square frames. For each of a number of random
+// Heaviside functions, every frame's 0/1 mask is filtered spatially and then exponentially averaged with the frames before it,
+// the way a renderer would filter the noise, and the variance of the result over the frame's pixels is the squared error of
+// that frame. Writes <name>_temporal.csv, the RMS error per frame, one per line in numpy's savetxt format, for
+// scripts/temporal-plot.py.
+//
+// The filters match the scipy ones temporal.py uses, with wrap around edges: a box of the given width, a gaussian with the given
+// sigma truncated at 4 sigma, or a binomial made of n 2 wide boxes. They are separable, so each is a horizontal pass then a
+// vertical pass, and both passes work on 4 pixels at a time with SSE. Samples run in parallel, each with its own generator,
+// so the results don't depend on the thread count.
+
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+
+#include "../common/ImageLoader.h"
+#include "../common/SampleSpace.h"
+#include "../../ThreadPool.h"
+
+#include <chrono>
+#include <emmintrin.h>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// A 1D filter: out[i] = sum over t of weights[t] * in[i + firstOffset + t], wrapping around
+struct Kernel
+{
+    int firstOffset = 0;
+    std::vector<float> weights;
+};
+
+static bool MakeKernel(const char* filter, const char* param, Kernel& kernel)
+{
+    if (!_stricmp(filter, "box") || !_stricmp(filter, "uniform"))
+    {
+        int size = atoi(param);
+        if (size < 1)
+            return false;
+        kernel.firstOffset = -(size / 2);
+        kernel.weights.assign(size, 1.0f / float(size));
+        return true;
+    }
+
+    if (!_stricmp(filter, "gauss"))
+    {
+        double sigma = atof(param);
+        if (sigma <= 0.0)
+            return false;
+        int radius = int(4.0 * sigma + 0.5);
+        std::vector<double> weights(radius * 2 + 1);
+        double sum = 0.0;
+        for (int i = -radius; i <= radius; ++i)
+        {
+            weights[i + radius] = exp(-0.5 * double(i * i) / (sigma * sigma));
+            sum += weights[i + radius];
+        }
+        kernel.firstOffset = -radius;
+        kernel.weights.resize(weights.size());
+        for (size_t i = 0; i < weights.size(); ++i)
+            kernel.weights[i] = float(weights[i] / sum);
+        return true;
+    }
+
+    if (!_stricmp(filter, "binomial"))
+    {
+        // n passes of a box covering [i - 1, i]
+        int n = atoi(param);
+        if (n < 1)
+            return false;
+        std::vector<double> weights(1, 1.0);
+        for (int pass = 0; pass < n; ++pass)
+        {
+            std::vector<double> next(weights.size() + 1, 0.0);
+            for (size_t i = 0; i < weights.size(); ++i)
+            {
+                next[i] += 0.5 * weights[i];
+                next[i + 1] += 0.5 * weights[i];
+            }
+            weights = next;
+        }
+        kernel.firstOffset = -n;
+        kernel.weights.assign(weights.begin(), weights.end());
+        return true;
+    }
+
+    return false;
+}
+
+// Per thread buffers
+struct Scratch
+{
+    std::vector<float> mask;
+    std::vector<float> padded;
+    std::vector<float> horizontal;
+    std::vector<float> filtered;
+    std::vector<float> result;
+    std::vector<double> variance;
+};
+
+// Filters each row of a size x size image. The row is copied with its wrap around on both ends, so the inner loop is
+// straight unaligned loads.
+static void FilterHorizontal(float* dest, const float* src, int size, const Kernel& kernel, std::vector<float>& padded)
+{
+    const int taps = (int)kernel.weights.size();
+    padded.resize(size_t(size) + taps + 3);
+    for (int y = 0; y < size; ++y)
+    {
+        const float* row = &src[size_t(y) * size];
+        float* out = &dest[size_t(y) * size];
+        for (int i = 0; i < size + taps - 1; ++i)
+        {
+            int x = (i + kernel.firstOffset) % size;
+            padded[i] = row[x < 0 ? x + size : x];
+        }
+
+        int x = 0;
+        for (; x + 4 <= size; x += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (int t = 0; t < taps; ++t)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel.weights[t]), _mm_loadu_ps(&padded[x + t])));
+            _mm_storeu_ps(&out[x], sum);
+        }
+        for (; x < size; ++x)
+        {
+            float sum = 0.0f;
+            for (int t = 0; t < taps; ++t)
+                sum += kernel.weights[t] * padded[x + t];
+            out[x] = sum;
+        }
+    }
+}
+
+// Filters each column, a row of 4 columns at a time
+static void FilterVertical(float* dest, const float* src, int size, const Kernel& kernel)
+{
+    const int taps = (int)kernel.weights.size();
+    for (int y = 0; y < size; ++y)
+    {
+        float* out = &dest[size_t(y) * size];
+        int x = 0;
+        for (; x + 4 <= size; x += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (int t = 0; t < taps; ++t)
+            {
+                int srcY = (y + kernel.firstOffset + t) % size;
+                srcY = srcY < 0 ? srcY + size : srcY;
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel.weights[t]), _mm_loadu_ps(&src[size_t(srcY) * size + x])));
+            }
+            _mm_storeu_ps(&out[x], sum);
+        }
+        for (; x < size; ++x)
+        {
+            float sum = 0.0f;
+            for (int t = 0; t < taps; ++t)
+            {
+                int srcY = (y + kernel.firstOffset + t) % size;
+                srcY = srcY < 0 ? srcY + size : srcY;
+                sum += kernel.weights[t] * src[size_t(srcY) * size + x];
+            }
+            out[x] = sum;
+        }
+    }
+}
+
+// The population variance, like np.var, in two passes for accuracy
+static double Variance(const float* values, size_t count)
+{
+    double mean = 0.0;
+    for (size_t i = 0; i < count; ++i)
+        mean += values[i];
+    mean /= double(count);
+
+    double variance = 0.0;
+    for (size_t i = 0; i < count; ++i)
+        variance += (values[i] - mean) * (values[i] - mean);
+    return variance / double(count);
+}
+
+static void PrintUsage()
+{
+    printf(
+        "fastnoise-temporal.exe <fileName> <sampleSpace> <spatialFilter> <filterParam> <alpha> [-samples <count>] [-seed <seed>] [-threads <count>]\n"
+        "  <fileName>      - A PNG, HDR or EXR FastNoise texture, read as a stack of square frames.\n"
+        "  <sampleSpace>   - real | circle | vector2 | vector3 | vector4 | sphere\n"
+        "  <spatialFilter> - box (or uniform) | binomial | gauss\n"
+        "  <filterParam>   - The box width, the number of binomial passes or the gaussian sigma.\n"
+        "  <alpha>         - The exponential moving average's alpha.\n"
+        "  -samples        - How many random Heaviside functions to average over. Defaults to 256.\n"
+        "  -seed           - Seeds the random Heaviside functions. Defaults to 0.\n"
+        "  -threads        - Worker threads, 0 for one per hardware thread. Defaults to 0.\n"
+        "Writes <name>_temporal.csv next to the texture.\n"
+    );
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 6)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* fileName = argv[1];
+    const SampleSpaceInfo* sampleSpaceInfo = SampleSpaceFromString(argv[2]);
+    if (!sampleSpaceInfo)
+    {
+        printf("[Error] Unknown sample space \"%s\"\n\n", argv[2]);
+        PrintUsage();
+        return 1;
+    }
+
+    Kernel kernel;
+    if (!MakeKernel(argv[3], argv[4], kernel))
+    {
+        printf("[Error] Unsupported filter \"%s %s\"\n\n", argv[3], argv[4]);
+        PrintUsage();
+        return 1;
+    }
+
+    const float alpha = (float)atof(argv[5]);
+
+    int sampleCount = 256;
+    unsigned int seed = 0;
+    int threadCount = 0;
+    for (int i = 6; i < argc; ++i)
+    {
+        if (!_stricmp(argv[i], "-samples") && i + 1 < argc)
+            sampleCount = atoi(argv[++i]);
+        else if (!_stricmp(argv[i], "-seed") && i + 1 < argc)
+            seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+        else if (!_stricmp(argv[i], "-threads") && i + 1 < argc)
+            threadCount = atoi(argv[++i]);
+        else
+        {
+            printf("[Error] Unknown option \"%s\"\n\n", argv[i]);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (sampleCount < 1)
+    {
+        printf("[Error] -samples must be at least 1\n");
+        return 1;
+    }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    LoadedImage image;
+    if (!LoadImage(fileName, image))
+    {
+        printf("[Error] Could not load \"%s\"\n", fileName);
+        return 1;
+    }
+
+    if (image.height % image.width != 0)
+    {
+        printf("[Error] \"%s\" is %i x %i, which isn't a stack of square frames\n", fileName, image.width, image.height);
+        return 1;
+    }
+
+    const int size = image.width;
+    const int frameCount = image.height / image.width;
+    const size_t framePixels = size_t(size) * size;
+    printf("Dimensions %i x %i, interpreting as %i frames of %i x %i\n", image.width, image.height, frameCount, size, size);
+
+    // The sample space's channels, with 8 bit values mapped from [0, 1] to [-1, 1) the way temporal.py does
+    const SampleSpace sampleSpace = sampleSpaceInfo->sampleSpace;
+    const int components = sampleSpaceInfo->components;
+    std::vector<float> values(framePixels * frameCount * components);
+    for (size_t pixel = 0; pixel < framePixels * frameCount; ++pixel)
+    {
+        for (int i = 0; i < components; ++i)
+        {
+            float value = image.pixels[pixel * 4 + i];
+            values[pixel * components + i] = image.isFloat ? value : (value - 0.5f) * 2.0f * 255.0f / 256.0f;
+        }
+    }
+
+    ThreadPool threadPool(threadCount);
+    std::vector<Scratch> scratches(threadPool.GetThreadCount() + 1);
+
+    threadPool.ParallelFor(sampleCount,
+        [&](int sample, int threadIndex)
+        {
+            Scratch& scratch = scratches[threadIndex];
+            if (scratch.variance.empty())
+            {
+                scratch.mask.resize(framePixels);
+                scratch.horizontal.resize(framePixels);
+                scratch.filtered.resize(framePixels);
+                scratch.result.resize(framePixels);
+                scratch.variance.resize(frameCount, 0.0);
+            }
+
+            const __m128 alpha4 = _mm_set1_ps(alpha);
+            const __m128 oneMinusAlpha4 = _mm_set1_ps(1.0f - alpha);
+            for (int frame = 0; frame < frameCount; ++frame)
+            {
+                // A new Heaviside function every frame, as temporal.py does
+                std::seed_seq seq{ seed, (unsigned int)sample, (unsigned int)frame };
+                std::mt19937 rng(seq);
+                Heaviside heaviside = MakeHeaviside(sampleSpace, sample, sampleCount, rng);
+                MakeMask(scratch.mask.data(), &values[framePixels * frame * components], framePixels, components, sampleSpace, heaviside);
+
+                FilterHorizontal(scratch.horizontal.data(), scratch.mask.data(), size, kernel, scratch.padded);
+                FilterVertical(scratch.filtered.data(), scratch.horizontal.data(), size, kernel);
+
+                if (frame == 0)
+                {
+                    scratch.result = scratch.filtered;
+                }
+                else
+                {
+                    size_t i = 0;
+                    for (; i + 4 <= framePixels; i += 4)
+                    {
+                        __m128 value = _mm_add_ps(_mm_mul_ps(alpha4, _mm_loadu_ps(&scratch.filtered[i])), _mm_mul_ps(oneMinusAlpha4, _mm_loadu_ps(&scratch.result[i])));
+                        _mm_storeu_ps(&scratch.result[i], value);
+                    }
+                    for (; i < framePixels; ++i)
+                        scratch.result[i] = alpha * scratch.filtered[i] + (1.0f - alpha) * scratch.result[i];
+                }
+
+                scratch.variance[frame] += Variance(scratch.result.data(), framePixels);
+            }
+        }
+    );
+
+    std::vector<double> variance(frameCount, 0.0);
+    for (const Scratch& scratch : scratches)
+    {
+        for (size_t frame = 0; frame < scratch.variance.size(); ++frame)
+            variance[frame] += scratch.variance[frame];
+    }
+
+    std::string csvFileName = OutputFileName(fileName, "_temporal.csv");
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName.c_str(), "wb");
+    if (!file)
+    {
+        printf("[Error] Could not open file for writing \"%s\"\n", csvFileName.c_str());
+        return 1;
+    }
+
+    for (int frame = 0; frame < frameCount; ++frame)
+        fprintf(file, "%.18e\n", sqrt(variance[frame] / double(sampleCount)));
+    fclose(file);
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - start).count();
+    printf("%i samples on %i threads in %0.2f seconds\nWrote \"%s\"\n", sampleCount, (int)scratches.size(), seconds, csvFileName.c_str());
+    return 0;
+}
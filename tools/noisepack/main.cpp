@@ -0,0 +1,408 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+// Packs a folder of FastNoise outputs, such as the unzipped noise.zip, into a single NoiseArchive. Textures are found
+// recursively and keyed by their file names, which follow makenoise.bat's convention:
+//
+//   <sampleSpace>_<distribution>_<filterXY>[_<filterZ>_<combine>][_<slice>].<png|hdr|exr>
+//
+// e.g. real_uniform_box3x3.png or sphere_coshemi_gauss1_0_Gauss10_separate05_12.png. The slices that -split writes are
+// stacked into one volume. An unsplit temporal texture is a tall atlas of square slices. Step files (name.123.png) are
+// skipped. Each texture is converted to a GPU format with VolumeTexture::Encode, the same code as -volume uses.
+
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+
+#include "../common/ImageLoader.h"
+#include "../common/SampleSpace.h"
+#include "../../NoiseArchive.h"
+#include "../../ThreadPool.h"
+#include "../../VolumeTexture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct Slice
+{
+    int z = 0;
+    std::string fileName;
+};
+
+// One texture of the archive: a single file, or the slices of a -split volume
+struct Texture
+{
+    std::string sampleSpace;
+    std::string distribution;
+    std::string filterXY;
+    std::string filterZ;
+    std::string combine;
+    std::vector<Slice> slices;
+};
+
+static std::vector<std::string> Split(const std::string& s, char separator)
+{
+    std::vector<std::string> ret;
+    size_t start = 0;
+    while (true)
+    {
+        size_t end = s.find(separator, start);
+        ret.push_back(s.substr(start, end - start));
+        if (end == std::string::npos)
+            break;
+        start = end + 1;
+    }
+    return ret;
+}
+
+static bool StartsWith(const std::string& s, const char* prefix)
+{
+    return !_strnicmp(s.c_str(), prefix, strlen(prefix));
+}
+
+static bool IsNumber(const std::string& s)
+{
+    return !s.empty() && s.find_first_not_of("0123456789") == std::string::npos;
+}
+
+// Splits a file name stem into the settings it was made with. Returns false if it doesn't follow the convention.
+static bool ParseName(const std::string& stem, Texture& texture)
+{
+    std::vector<std::string> tokens = Split(stem, '_');
+    if (tokens.size() < 3)
+        return false;
+
+    texture.sampleSpace = tokens[0];
+    texture.distribution = tokens[1];
+
+    // A temporal texture ends with its temporal filter and how the filters are combined
+    size_t filterXYEnd = tokens.size();
+    if (tokens.size() >= 5 && (StartsWith(tokens.back(), "product") || StartsWith(tokens.back(), "separate")))
+    {
+        texture.combine = tokens[tokens.size() - 1];
+        texture.filterZ = tokens[tokens.size() - 2];
+        filterXYEnd -= 2;
+    }
+
+    // The spatial filter can have underscores in it, like gauss1_0
+    texture.filterXY = tokens[2];
+    for (size_t i = 3; i < filterXYEnd; ++i)
+        texture.filterXY += "_" + tokens[i];
+    return true;
+}
+
+// Groups the images under a folder into textures, keyed by folder and name so slices find each other
+static void FindTextures(const char* folder, std::map<std::string, Texture>& textures)
+{
+    for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(folder))
+    {
+        if (!entry.is_regular_file())
+            continue;
+
+        std::filesystem::path path = entry.path();
+        std::string extension = path.extension().string();
+        if (_stricmp(extension.c_str(), ".png") && _stricmp(extension.c_str(), ".hdr") && _stricmp(extension.c_str(), ".exr"))
+            continue;
+
+        // Step files have a second extension
+        std::string stem = path.stem().string();
+        if (stem.find('.') != std::string::npos)
+            continue;
+
+        // A -split slice ends in _<z>, but so does a spatial filter like gauss1_0, so only temporal names are slices
+        Texture texture;
+        Slice slice;
+        slice.fileName = path.string();
+        size_t lastUnderscore = stem.rfind('_');
+        if (lastUnderscore != std::string::npos && IsNumber(stem.substr(lastUnderscore + 1)) && ParseName(stem.substr(0, lastUnderscore), texture) && !texture.combine.empty())
+        {
+            slice.z = atoi(stem.substr(lastUnderscore + 1).c_str());
+            stem = stem.substr(0, lastUnderscore);
+        }
+        else if (!ParseName(stem, texture))
+        {
+            printf("[Warning] Skipping \"%s\", the name isn't <sampleSpace>_<distribution>_<filterXY>[_<filterZ>_<combine>]\n", slice.fileName.c_str());
+            continue;
+        }
+
+        std::string groupName = (path.parent_path() / stem).string();
+        Texture& group = textures[groupName];
+        if (group.slices.empty())
+        {
+            texture.slices.clear();
+            group = texture;
+        }
+        group.slices.push_back(slice);
+    }
+}
+
+// The channels each sample space uses, as FastNoise saves them by default. Three component spaces are stored as four
+// channels, as there are no three channel formats.
+static int SampleSpaceChannels(const std::string& sampleSpace)
+{
+    const SampleSpaceInfo* info = SampleSpaceFromString(sampleSpace.c_str());
+    return info ? info->components : 4;
+}
+
+static VolumeTexture::Format AutoFormat(int channels, bool isFloat)
+{
+    if (isFloat)
+        return (channels == 1) ? VolumeTexture::Format::R16F : VolumeTexture::Format::RGBA16F;
+    switch (channels)
+    {
+        case 1: return VolumeTexture::Format::R8;
+        case 2: return VolumeTexture::Format::RG8;
+        default: return VolumeTexture::Format::RGBA8;
+    }
+}
+
+// Loads a texture as a width x (height * depth) RGBA float atlas
+static bool LoadTexture(Texture& texture, LoadedImage& volume, int& depth)
+{
+    std::sort(texture.slices.begin(), texture.slices.end(), [](const Slice& a, const Slice& b) { return a.z < b.z; });
+
+    depth = 0;
+    for (const Slice& slice : texture.slices)
+    {
+        if (slice.z != depth)
+        {
+            printf("[Error] \"%s\" should be slice %i\n", slice.fileName.c_str(), depth);
+            return false;
+        }
+
+        LoadedImage image;
+        if (!LoadImage(slice.fileName.c_str(), image))
+        {
+            printf("[Error] Could not load \"%s\"\n", slice.fileName.c_str());
+            return false;
+        }
+
+        if (depth == 0)
+        {
+            volume.width = image.width;
+            volume.height = image.height;
+            volume.components = image.components;
+            volume.isFloat = image.isFloat;
+        }
+        else if (image.width != volume.width || image.height != volume.height || image.isFloat != volume.isFloat)
+        {
+            printf("[Error] \"%s\" doesn't match the other slices\n", slice.fileName.c_str());
+            return false;
+        }
+
+        volume.pixels.insert(volume.pixels.end(), image.pixels.begin(), image.pixels.end());
+        depth++;
+    }
+
+    // An unsplit temporal texture is a tall atlas of square slices
+    if (depth == 1 && !texture.filterZ.empty() && volume.height > volume.width && volume.height % volume.width == 0)
+    {
+        depth = volume.height / volume.width;
+        volume.height = volume.width;
+    }
+    return true;
+}
+
+static bool WritePadding(FILE* file, uint64_t& offset)
+{
+    static const unsigned char c_zeros[NoiseArchive::c_alignment] = {};
+    size_t padding = size_t((NoiseArchive::c_alignment - offset % NoiseArchive::c_alignment) % NoiseArchive::c_alignment);
+    offset += padding;
+    return fwrite(c_zeros, 1, padding, file) == padding;
+}
+
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static int List(const char* archiveFileName)
+{
+    NoiseArchive archive;
+    char error[1024];
+    if (!archive.Open(archiveFileName, error, sizeof(error)))
+    {
+        printf("[Error] %s\n", error);
+        return 1;
+    }
+
+    printf("%u textures\n", archive.GetEntryCount());
+    for (uint32_t index = 0; index < archive.GetEntryCount(); ++index)
+    {
+        const NoiseArchive::Entry& entry = archive.GetEntry(index);
+        printf("  %s %s %s %s %s %ux%ux%u  DXGI_FORMAT %u  %llu bytes\n",
+            entry.key.sampleSpace, entry.key.distribution, entry.key.filterXY,
+            entry.key.filterZ[0] ? entry.key.filterZ : "-", entry.key.combine[0] ? entry.key.combine : "-",
+            entry.key.width, entry.key.height, entry.key.depth, entry.dxgiFormat, (unsigned long long)entry.size);
+    }
+    return 0;
+}
+
+// Opens the archive the way a runtime would, finds every texture by key and reads one byte per page of it
+static bool TimeArchive(const char* archiveFileName, const std::vector<NoiseArchive::Entry>& entries, double& milliseconds)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    NoiseArchive archive;
+    char error[1024];
+    if (!archive.Open(archiveFileName, error, sizeof(error)))
+    {
+        printf("[Error] %s\n", error);
+        return false;
+    }
+
+    unsigned int sum = 0;
+    for (const NoiseArchive::Entry& entry : entries)
+    {
+        NoiseArchive::View view;
+        if (!archive.Find(entry.key, view) || view.size != entry.size)
+        {
+            printf("[Error] %s_%s_%s is missing from the archive\n", entry.key.sampleSpace, entry.key.distribution, entry.key.filterXY);
+            return false;
+        }
+        for (size_t i = 0; i < view.size; i += NoiseArchive::c_alignment)
+            sum += view.data[i];
+    }
+
+    milliseconds = MillisecondsSince(start);
+
+    // So the reads aren't optimized away
+    if (sum == 0xFFFFFFFF)
+        printf("\n");
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && !_stricmp(argv[1], "-list"))
+        return List(argv[2]);
+
+    bool autoFormat = true;
+    VolumeTexture::Format format = VolumeTexture::Format::RGBA8;
+    if (argc == 5 && !_stricmp(argv[3], "-format"))
+    {
+        autoFormat = !_stricmp(argv[4], "auto");
+        if (!autoFormat && !VolumeTexture::FormatFromString(argv[4], format))
+        {
+            printf("[Error] Unknown format \"%s\"\n", argv[4]);
+            return 1;
+        }
+    }
+    else if (argc != 3)
+    {
+        printf(
+            "noisepack.exe <folder> <archive> [-format <format>]\n"
+            "  Packs the FastNoise outputs under <folder> into <archive>.\n"
+            "  <format> is auto (the default), r8, rg8, rgba8, r16f, rgba16f, bc4, bc5 or bc7.\n"
+            "  auto uses the channels of the sample space, 8 bit for PNGs and 16 bit float for HDR and EXR.\n"
+            "\n"
+            "noisepack.exe -list <archive>\n"
+            "  Lists the textures in <archive>.\n"
+        );
+        return 1;
+    }
+
+    const char* folder = argv[1];
+    const char* archiveFileName = argv[2];
+
+    std::map<std::string, Texture> textures;
+    FindTextures(folder, textures);
+    if (textures.empty())
+    {
+        printf("[Error] No textures found in \"%s\"\n", folder);
+        return 1;
+    }
+
+    FILE* file = nullptr;
+    fopen_s(&file, archiveFileName, "wb");
+    if (!file)
+    {
+        printf("[Error] Could not open file for writing \"%s\"\n", archiveFileName);
+        return 1;
+    }
+
+    // Payloads are written as they are made, after space for the header and index
+    std::vector<NoiseArchive::Entry> entries;
+    uint64_t offset = sizeof(NoiseArchive::Header) + textures.size() * sizeof(NoiseArchive::Entry);
+    bool success = _fseeki64(file, (long long)offset, SEEK_SET) == 0 && WritePadding(file, offset);
+
+    ThreadPool threadPool;
+    double decodeMilliseconds = 0.0;
+    std::vector<unsigned char> data;
+    for (auto it = textures.begin(); it != textures.end() && success; ++it)
+    {
+        Texture& texture = it->second;
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        LoadedImage volume;
+        int depth = 0;
+        success = LoadTexture(texture, volume, depth);
+        decodeMilliseconds += MillisecondsSince(start);
+        if (!success)
+            break;
+
+        VolumeTexture::Format textureFormat = autoFormat ? AutoFormat(SampleSpaceChannels(texture.sampleSpace), volume.isFloat) : format;
+        VolumeTexture::Encode(data, volume.pixels.data(), volume.width, volume.height, depth, textureFormat, &threadPool);
+
+        NoiseArchive::Entry entry;
+        entry.key = NoiseArchive::MakeKey(texture.sampleSpace.c_str(), texture.distribution.c_str(), texture.filterXY.c_str(), texture.filterZ.c_str(), texture.combine.c_str(), volume.width, volume.height, depth);
+        size_t rowPitch, slicePitch;
+        VolumeTexture::GetPitches(textureFormat, volume.width, volume.height, rowPitch, slicePitch);
+        entry.dxgiFormat = VolumeTexture::GetDXGIFormat(textureFormat);
+        entry.rowPitch = (uint32_t)rowPitch;
+        entry.slicePitch = (uint32_t)slicePitch;
+        entry.offset = offset;
+        entry.size = data.size();
+        entries.push_back(entry);
+
+        offset += data.size();
+        success = fwrite(data.data(), 1, data.size(), file) == data.size() && WritePadding(file, offset);
+        printf("%s: %ix%ix%i\n", it->first.c_str(), volume.width, volume.height, depth);
+    }
+
+    // The index is sorted by key for Find()'s binary search, and two files with the same key would make it ambiguous
+    std::sort(entries.begin(), entries.end(), [](const NoiseArchive::Entry& a, const NoiseArchive::Entry& b) { return NoiseArchive::Compare(a.key, b.key) < 0; });
+    for (size_t index = 1; index < entries.size() && success; ++index)
+    {
+        if (NoiseArchive::Compare(entries[index - 1].key, entries[index].key) == 0)
+        {
+            printf("[Error] Two textures have the key %s_%s_%s_%s_%s %ux%ux%u\n", entries[index].key.sampleSpace, entries[index].key.distribution,
+                entries[index].key.filterXY, entries[index].key.filterZ, entries[index].key.combine, entries[index].key.width, entries[index].key.height, entries[index].key.depth);
+            success = false;
+        }
+    }
+
+    if (success)
+    {
+        NoiseArchive::Header header;
+        memcpy(header.magic, "FNPK", 4);
+        header.version = NoiseArchive::c_version;
+        header.entryCount = (uint32_t)entries.size();
+        header.alignment = NoiseArchive::c_alignment;
+        success = _fseeki64(file, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(entries.data(), sizeof(NoiseArchive::Entry), entries.size(), file) == entries.size();
+    }
+    fclose(file);
+
+    if (!success)
+    {
+        printf("[Error] Could not write \"%s\"\n", archiveFileName);
+        return 1;
+    }
+
+    double archiveMilliseconds = 0.0;
+    if (!TimeArchive(archiveFileName, entries, archiveMilliseconds))
+        return 1;
+
+    printf("\n%zu textures, %llu bytes\n", entries.size(), (unsigned long long)offset);
+    printf("Decoding the source images took %0.2f ms. Opening the archive and touching every page of every texture took %0.2f ms.\n", decodeMilliseconds, archiveMilliseconds);
+    return 0;
+}
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+//               FastNoise - F.A.S.T. Sampling Implementation                //
+//         Copyright (c) 2023 Electronic Arts Inc. All rights reserved.      //
+///////////////////////////////////////////////////////////////////////////////
+
+// Compares stbi_write_png against PNGEncoder at each filter, compression level and thread count, for encode time and file size.
+// By default it encodes a 128 x (128*64) RGBA atlas of random values, which is how FastNoise's output looks to a compressor.
+// A PNG file can be given on the command line instead.
+
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../../fastnoise/DX12Utils/stb/stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../../fastnoise/DX12Utils/stb/stb_image_write.h"
+
+#include "../../PNGEncoder.h"
+#include "../../ThreadPool.h"
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const int c_repeatCount = 5;
+
+struct Image
+{
+    int width = 128;
+    int height = 128 * 64;
+    int components = 4;
+    std::vector<unsigned char> pixels;
+};
+
+static void WriteToVector(void* context, void* data, int size)
+{
+    std::vector<unsigned char>& out = *(std::vector<unsigned char>*)context;
+    out.insert(out.end(), (unsigned char*)data, (unsigned char*)data + size);
+}
+
+// Returns the fastest of c_repeatCount runs in milliseconds
+template <typename LAMBDA>
+static double Time(const LAMBDA& lambda)
+{
+    double best = 0.0;
+    for (int i = 0; i < c_repeatCount; ++i)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        lambda();
+        double ms = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::high_resolution_clock::now() - start).count();
+        if (i == 0 || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+// Makes sure the PNG decodes back to the source pixels
+static bool Verify(const std::vector<unsigned char>& png, const Image& image)
+{
+    int width, height, components;
+    unsigned char* pixels = stbi_load_from_memory(png.data(), (int)png.size(), &width, &height, &components, 0);
+    if (!pixels)
+        return false;
+    bool ret = width == image.width && height == image.height && components == image.components && memcmp(pixels, image.pixels.data(), image.pixels.size()) == 0;
+    stbi_image_free(pixels);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    Image image;
+    if (argc > 1)
+    {
+        unsigned char* pixels = stbi_load(argv[1], &image.width, &image.height, &image.components, 0);
+        if (!pixels)
+        {
+            printf("[Error] Could not load \"%s\"\n", argv[1]);
+            return 1;
+        }
+        image.pixels.assign(pixels, pixels + image.width * image.height * image.components);
+        stbi_image_free(pixels);
+    }
+    else
+    {
+        std::mt19937 rng(0);
+        std::uniform_int_distribution<int> dist(0, 255);
+        image.pixels.resize(image.width * image.height * image.components);
+        for (unsigned char& value : image.pixels)
+            value = (unsigned char)dist(rng);
+    }
+
+    printf("%i x %i, %i components, %i bytes raw. Best of %i runs.\n\n", image.width, image.height, image.components, (int)image.pixels.size(), c_repeatCount);
+    printf("encoder     filter    level  threads      ms        bytes   vs stb\n");
+
+    // stb at its default settings is the baseline
+    std::vector<unsigned char> png;
+    double stbMs = Time([&]()
+        {
+            png.clear();
+            stbi_write_png_to_func(WriteToVector, &png, image.width, image.height, image.components, image.pixels.data(), 0);
+        }
+    );
+    size_t stbBytes = png.size();
+    printf("stb         adaptive  %5i  %7i  %6.2f  %11i  %6.2f%s\n", stbi_write_png_compression_level, 1, stbMs, (int)stbBytes, 1.0, Verify(png, image) ? "" : "  DECODE FAILED");
+
+    static const char* c_filters[] = { "none", "sub", "up", "average", "paeth", "adaptive" };
+    static const int c_levels[] = { 1, 3, 6, 9 };
+    // Total threads, counting the calling thread
+    static const int c_threadCounts[] = { 1, 2, 4, 8 };
+
+    for (const char* filterName : c_filters)
+    {
+        for (int level : c_levels)
+        {
+            for (int threadCount : c_threadCounts)
+            {
+                std::unique_ptr<ThreadPool> threadPool;
+                if (threadCount > 1)
+                    threadPool = std::make_unique<ThreadPool>(threadCount - 1);
+
+                PNGEncoder::Settings settings;
+                PNGEncoder::FilterFromString(filterName, settings.filter);
+                settings.compressionLevel = level;
+                settings.threadPool = threadPool.get();
+
+                bool success = true;
+                double ms = Time([&]()
+                    {
+                        success &= PNGEncoder::Encode(png, image.pixels.data(), image.width, image.height, image.components, settings);
+                    }
+                );
+                success &= Verify(png, image);
+
+                printf("PNGEncoder  %-8s  %5i  %7i  %6.2f  %11i  %6.2f%s\n", filterName, level, threadCount, ms, (int)png.size(), double(png.size()) / double(stbBytes), success ? "" : "  DECODE FAILED");
+            }
+        }
+    }
+
+    return 0;
+}